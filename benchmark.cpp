@@ -0,0 +1,600 @@
+/****************************************************************************************
+ * Micro benchmarks:  benchmark [section]
+ *
+ *   small      per polygon latency of the small polygon path vs EarClipper, 3..16 points
+ *   large      EarClipper time per polygon on star polygons of 64..16384 points and comb
+ *              polygons of 64..262144 points, per reflex index (no scan above 16384)
+ *   inside     reflex point test per ear: inside_triangle vs the clipper's ear_box +
+ *              blocks_ear
+ *   locate     point in polygon: ray casting vs TriangleGrid, single and batched
+ *   moments    area, centroid and second moments: separate passes vs polygon_moments,
+ *              one thread and batched over the thread pool
+ *   coverage   copper density map of a board: 4x4 supersampled scanlines over the rings
+ *              vs CoverageRaster over the triangulation
+ *   weld       batch of adjacent tiles: per polygon index buffers vs triangulate_welded
+ *   allocators EarClipper memory from operator new, a pmr pool and a bump allocator, for
+ *              a clipper reused across polygons and a fresh clipper per polygon
+ *   hugepages  multi million point combs: operator new vs a pool on 4 KB pages vs the
+ *              same pool on huge pages (HugePagePool), time and dTLB misses per point;
+ *              half a GB and half a minute, so only when named
+ *   calibrate  measure EarClipper::ReflexIndexCosts for this machine
+ **/
+#include "coverage_raster.h"
+#include "huge_pages.h"
+#include "mesh_welding.h"
+#include "point_location.h"
+#include "polygon_moments.h"
+#include "small_earclipper.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory_resource>
+#include <random>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Random polygon star shaped around the origin: jittered angles keep every gap below
+// pi, radii in [0.3, 1] make it concave more often than not.
+std::vector<Point> star_polygon(size_t n, std::mt19937_64& rng, double radius = 1.0) {
+    std::uniform_real_distribution<double> jitter(0, 0.4), r(0.3, 1.0);
+    std::vector<Point> points;
+    for(size_t i = 0; i < n; ++i) {
+        auto a = (i + jitter(rng)) * 2 * M_PI / n;
+        auto d = radius * r(rng);
+        points.push_back({Num(d * std::cos(a) * scale), Num(d * std::sin(a) * scale)});
+    }
+    return points;
+}
+
+// Comb with n/4 fine teeth on a base bar: the reflex points cluster along the tooth
+// bases, the case that defeats uniform bucketing.
+std::vector<Point> comb_polygon(size_t n, double width = 100.0) {
+    size_t teeth = std::max<size_t>(1, n / 4);
+    auto pitch = width / teeth;
+    std::vector<Point> points{{0, 0}, {Num(width * scale), 0}};
+    for(size_t t = teeth; t-- > 0; ) {
+        auto x = t * pitch;
+        points.push_back({Num((x + pitch) * scale), Num(1.0 * scale)});
+        points.push_back({Num((x + 0.6 * pitch) * scale), Num(50.0 * scale)});
+        points.push_back({Num((x + 0.4 * pitch) * scale), Num(50.0 * scale)});
+        points.push_back({Num(x * scale), Num(1.0 * scale)});
+    }
+    points.pop_back();
+    return points;
+}
+
+template<typename F>
+double nanoseconds_per_call(size_t calls, F&& f) {
+    auto start = Clock::now();
+    for(size_t i = 0; i < calls; ++i)
+        f(i);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls;
+}
+
+void bench_small() {
+    std::mt19937_64 rng(42);
+    constexpr size_t polygons = 1024, rounds = 200;
+    std::cout << "points  small_ns  earclipper_ns\n";
+    for(size_t n = 3; n <= small_polygon_max; ++n) {
+        std::vector<std::vector<Point>> inputs;
+        for(size_t i = 0; i < polygons; ++i)
+            inputs.push_back(star_polygon(n, rng));
+        std::vector<uint32_t> out(3 * n);
+        EarClipper clipper;
+        size_t sink = 0;
+
+        auto small = nanoseconds_per_call(polygons * rounds, [&](size_t i) {
+            auto& p = inputs[i % polygons];
+            sink += small_polygon::table[n - 3](p.data(), out.data()).size;
+        });
+        auto general = nanoseconds_per_call(polygons * rounds / 10, [&](size_t i) {
+            auto& p = inputs[i % polygons];
+            clipper.reset(p.begin(), p.end());
+            clipper.clip([&](Vertex const&, Vertex const&, Vertex const&) { ++sink; });
+        });
+        std::cout << std::setw(6) << n << std::setw(10) << std::setprecision(1) << std::fixed << small
+                  << std::setw(15) << general << (sink ? "" : " ") << "\n";
+    }
+}
+
+void bench_large() {
+    std::mt19937_64 rng(7);
+    using Index = EarClipper::ReflexIndex;
+    EarClipper clipper;
+    for(auto shape : {"star", "comb"}) {
+        std::cout << shape << " points       scan_us   sorted_x_us    kd_tree_us  automatic_us\n";
+        // a star clips in quadratic time whatever the index: seconds beyond 16384 points
+        size_t largest = shape[0] == 's' ? 16384 : 262144;
+        for(size_t n = 64; n <= largest; n *= 4) {
+            auto polygon = shape[0] == 's' ? star_polygon(n, rng, 100.0) : comb_polygon(n);
+            size_t calls = std::max<size_t>(1, (1 << 22) / (n * n / 64 + n));
+            size_t sink = 0;
+            std::cout << std::setw(11) << n;
+            for(auto index : {Index::scan, Index::sorted_x, Index::kd_tree, Index::automatic}) {
+                if(index == Index::scan && n > 16384) {
+                    std::cout << std::setw(14) << "-";
+                    continue;
+                }
+                clipper.set_reflex_index(index);
+                auto ns = nanoseconds_per_call(calls, [&](size_t) {
+                    clipper.reset(polygon.begin(), polygon.end());
+                    clipper.clip([&](Vertex const&, Vertex const&, Vertex const&) { ++sink; });
+                });
+                std::cout << std::setw(14) << std::setprecision(1) << std::fixed << ns / 1000;
+            }
+            std::cout << (sink ? "" : " ") << "\n";
+        }
+    }
+}
+
+// The clipped ears and the reflex vertices of a star polygon: the distribution
+// check_ear actually sees.
+void bench_inside() {
+    std::mt19937_64 rng(11);
+    std::cout << "points  reflex  inside_triangle_ns  box_blocks_ear_ns  (per ear)\n";
+    for(size_t n = 256; n <= 16384; n *= 4) {
+        auto polygon = star_polygon(n, rng, 100.0);
+        std::vector<Point> reflex;
+        for(size_t i = 0; i < n; ++i) {
+            auto turn = triangle_area(polygon[(i + n - 1) % n], polygon[i], polygon[(i + 1) % n]);
+            if(turn <= 0)
+                reflex.push_back(polygon[i]);
+        }
+        std::vector<Triangle> ears;
+        EarClipper clipper;
+        clipper.reset(polygon.begin(), polygon.end());
+        clipper.clip([&](Vertex const& p0, Vertex const& p1, Vertex const& p2) { ears.push_back({p0, p1, p2}); });
+
+        size_t hits = 0;
+        auto plain = nanoseconds_per_call(ears.size(), [&](size_t i) {
+            auto& t = ears[i];
+            for(auto const& v : reflex)
+                hits += inside_triangle(v, t[0], t[1], t[2]);
+        });
+        auto filtered = nanoseconds_per_call(ears.size(), [&](size_t i) {
+            auto& t = ears[i];
+            auto box = ear_box(t[0], t[1], t[2]);
+            for(auto const& v : reflex)
+                hits += box.contains(v) && blocks_ear(v, t[0], t[1], t[2]);
+        });
+        std::cout << std::setw(6) << n << std::setw(8) << reflex.size() << std::setprecision(1) << std::fixed
+                  << std::setw(20) << plain << std::setw(19) << filtered << (hits ? "" : " ") << "\n";
+    }
+}
+
+// Ray casting against the ring, the O(n) per query baseline.
+bool ray_cast_inside(std::vector<Point> const& polygon, Point const& p) {
+    bool inside = false;
+    for(size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        auto const& a = polygon[i], &b = polygon[j];
+        if((a.y > p.y) != (b.y > p.y) && p.x < a.x + (long double)(p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+            inside = !inside;
+    }
+    return inside;
+}
+
+void bench_locate() {
+    std::mt19937_64 rng(13);
+    std::uniform_real_distribution<double> coord(-100, 100);
+    constexpr size_t queries = 1 << 18;
+    std::vector<Point> points(queries);
+    for(auto& p : points)
+        p = {Num(coord(rng) * scale), Num(coord(rng) * scale)};
+    std::cout << "shape  points  ray_cast_ns  single_ns  batch_ns  (per query)\n";
+    for(auto shape : {"star", "comb"}) {
+        for(size_t n = 256; n <= 65536; n *= 16) {
+            auto polygon = shape[0] == 's' ? star_polygon(n, rng, 100.0) : comb_polygon(n, 200.0);
+            std::vector<uint32_t> indices(3 * n);
+            EarClipper clipper;
+            indices.resize(triangulate_indices(clipper, polygon.data(), n, indices.data()).size);
+            TriangleGrid grid;
+            grid.build(polygon.data(), indices.data(), indices.size());
+
+            size_t hits = 0;
+            auto ray = nanoseconds_per_call(queries / n + 16, [&](size_t i) { hits += ray_cast_inside(polygon, points[i]); });
+            auto single = nanoseconds_per_call(queries, [&](size_t i) { hits += grid.contains(points[i]); });
+            std::vector<int32_t> found(queries);
+            auto batch = nanoseconds_per_call(1, [&](size_t) { grid.locate(points.data(), queries, found.data()); }) / queries;
+            std::cout << std::setw(5) << shape << std::setw(8) << n << std::setprecision(1) << std::fixed
+                      << std::setw(13) << ray << std::setw(11) << single << std::setw(10) << batch << (hits ? "" : " ") << "\n";
+        }
+    }
+}
+
+// The separate passes polygon_moments replaces: area, then centroid, then second moments
+// about the centroid, in double.
+void bench_moments() {
+    std::mt19937_64 rng(9);
+    std::cout << "points   separate ns/pt   one pass ns/pt   batch ns/pt\n";
+    for(size_t n : {16, 256, 4096}) {
+        std::vector<std::vector<Point>> polygons;
+        for(size_t i = 0; i < (1 << 20) / n; ++i)
+            polygons.push_back(star_polygon(n, rng, 100.0));
+        double sink = 0;
+        auto separate = nanoseconds_per_call(polygons.size(), [&](size_t i) {
+            auto const& p = polygons[i];
+            double a = 0, cx = 0, cy = 0, ixx = 0;
+            for(size_t k = 0; k < n; ++k) {
+                auto const& u = p[k], &v = p[(k + 1) % n];
+                a += double(u.x) * v.y - double(v.x) * u.y;
+            }
+            for(size_t k = 0; k < n; ++k) {
+                auto const& u = p[k], &v = p[(k + 1) % n];
+                double c = double(u.x) * v.y - double(v.x) * u.y;
+                cx += (double(u.x) + v.x) * c, cy += (double(u.y) + v.y) * c;
+            }
+            cx /= 3 * a, cy /= 3 * a;
+            for(size_t k = 0; k < n; ++k) {
+                auto const& u = p[k], &v = p[(k + 1) % n];
+                double x0 = u.x - cx, y0 = u.y - cy, x1 = v.x - cx, y1 = v.y - cy;
+                ixx += (x0 * x0 + x0 * x1 + x1 * x1) * (x0 * y1 - x1 * y0);
+            }
+            sink += cx + cy + ixx;
+        }) / n;
+        auto one = nanoseconds_per_call(polygons.size(), [&](size_t i) {
+            sink += double(polygon_moments(polygons[i]).central_xx());
+        }) / n;
+        auto batch = nanoseconds_per_call(1, [&](size_t) {
+            for(auto const& m : polygon_moments_batch(polygons))
+                sink += double(m.central_xx());
+        }) / (polygons.size() * n);
+        std::cout << std::setw(6) << n << std::setprecision(2) << std::fixed << std::setw(17) << separate
+                  << std::setw(17) << one << std::setw(14) << batch << (sink ? "" : " ") << "\n";
+        std::cout << std::defaultfloat;
+    }
+}
+
+// Scan conversion of the ring, the baseline CoverageRaster replaces: 4x4 samples per
+// cell, even-odd crossings per sample row.
+void supersample_ring(std::vector<Point> const& polygon, Point origin, Num cell, uint32_t nx, uint32_t ny,
+                      std::vector<double>& covered) {
+    constexpr int samples = 4;
+    std::vector<double> crossings;
+    auto [low, high] = std::minmax_element(polygon.begin(), polygon.end(), [](auto& a, auto& b) { return a.y < b.y; });
+    auto sy0 = uint32_t(std::clamp<double>(double(low->y - origin.y) * samples / cell, 0, ny * samples));
+    auto sy1 = uint32_t(std::clamp<double>(double(high->y - origin.y) * samples / cell + 1, 0, ny * samples));
+    for(uint32_t sy = sy0; sy < sy1; ++sy) {
+        double y = origin.y + (sy + 0.5) * cell / samples;
+        crossings.clear();
+        for(size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            auto const& a = polygon[i], &b = polygon[j];
+            if((a.y > y) != (b.y > y))
+                crossings.push_back(a.x + (y - a.y) * double(b.x - a.x) / double(b.y - a.y));
+        }
+        std::sort(crossings.begin(), crossings.end());
+        auto* row = &covered[size_t(sy / samples) * nx];
+        for(size_t k = 0; k + 1 < crossings.size(); k += 2) {
+            auto s0 = std::max(0.0, std::ceil((crossings[k] - origin.x) * samples / cell - 0.5));
+            auto s1 = std::min(double(nx * samples), std::ceil((crossings[k + 1] - origin.x) * samples / cell - 0.5));
+            for(auto sx = size_t(s0); sx < size_t(std::max(s0, s1)); ++sx)
+                row[sx / samples] += 1.0 / (samples * samples);
+        }
+    }
+}
+
+void bench_coverage() {
+    std::mt19937_64 rng(17);
+    std::uniform_real_distribution<double> position(0, 1000);
+    constexpr uint32_t cells = 1000;        // 1 mm cells over a 1 m board
+    std::cout << "points  polygons  supersample_ms  triangulate_ms  raster_ms  max_diff\n";
+    for(size_t n : {64, 1024}) {
+        size_t polygons = (1 << 20) / n;
+        std::vector<std::vector<Point>> board;
+        for(size_t i = 0; i < polygons; ++i) {
+            auto p = star_polygon(n, rng, 5.0);
+            Point at{Num(position(rng) * scale), Num(position(rng) * scale)};
+            for(auto& q : p)
+                q = {q.x + at.x, q.y + at.y};
+            board.push_back(std::move(p));
+        }
+        std::vector<double> sampled(size_t(cells) * cells, 0);
+        auto ring = nanoseconds_per_call(polygons, [&](size_t i) {
+            supersample_ring(board[i], {0, 0}, scale, cells, cells, sampled);
+        }) * polygons / 1e6;
+
+        // one triangulation of the whole board, as the raster consumes it
+        std::vector<Point> points;
+        std::vector<uint32_t> indices;
+        EarClipper clipper;
+        auto triangulate = nanoseconds_per_call(polygons, [&](size_t i) {
+            auto base = uint32_t(points.size());
+            auto count = indices.size();
+            points.insert(points.end(), board[i].begin(), board[i].end());
+            indices.resize(count + 3 * n);
+            indices.resize(count + triangulate_indices(clipper, board[i].data(), n, &indices[count]).size);
+            for(auto k = count; k < indices.size(); ++k)
+                indices[k] += base;
+        }) * polygons / 1e6;
+        CoverageRaster raster({0, 0}, scale, cells, cells);
+        auto fill = nanoseconds_per_call(1, [&](size_t) {
+            raster.add_triangles(points.data(), indices.data(), indices.size());
+        }) / 1e6;
+
+        double diff = 0;
+        for(uint32_t j = 0; j < cells; ++j)
+            for(uint32_t i = 0; i < cells; ++i)
+                diff = std::max(diff, std::abs(raster(i, j) - sampled[size_t(j) * cells + i]));
+        std::cout << std::setw(6) << n << std::setw(10) << polygons << std::setprecision(1) << std::fixed
+                  << std::setw(16) << ring << std::setw(16) << triangulate << std::setw(11) << fill
+                  << std::setprecision(3) << std::setw(10) << diff << "\n";
+        std::cout << std::defaultfloat;
+    }
+}
+
+// k x k tiles of a plane split along jittered lines, each tile edge subdivided into
+// `steps` points: every boundary point is shared by two or four tiles.
+std::vector<std::vector<Point>> tiled_plane(size_t k, size_t steps, std::mt19937_64& rng) {
+    std::uniform_real_distribution<double> jitter(-0.2, 0.2);
+    std::vector<std::vector<Point>> grid(k * steps + 1, std::vector<Point>(k * steps + 1));
+    for(size_t j = 0; j <= k * steps; ++j)
+        for(size_t i = 0; i <= k * steps; ++i) {
+            bool inner = i % steps && j % steps;
+            grid[j][i] = {Num((i + (inner ? 0 : jitter(rng))) * scale), Num((j + (inner ? 0 : jitter(rng))) * scale)};
+        }
+    std::vector<std::vector<Point>> tiles;
+    for(size_t tj = 0; tj < k; ++tj)
+        for(size_t ti = 0; ti < k; ++ti) {
+            std::vector<Point> ring;
+            size_t i0 = ti * steps, j0 = tj * steps;
+            for(size_t s = 0; s < steps; ++s) ring.push_back(grid[j0][i0 + s]);
+            for(size_t s = 0; s < steps; ++s) ring.push_back(grid[j0 + s][i0 + steps]);
+            for(size_t s = 0; s < steps; ++s) ring.push_back(grid[j0 + steps][i0 + steps - s]);
+            for(size_t s = 0; s < steps; ++s) ring.push_back(grid[j0 + steps - s][i0]);
+            tiles.push_back(std::move(ring));
+        }
+    return tiles;
+}
+
+void bench_weld() {
+    std::mt19937_64 rng(19);
+    std::cout << "tiles  points/tile  separate_ms  welded_ms  vertices  welded_vertices\n";
+    for(auto [k, steps] : {std::pair<size_t, size_t>{256, 4}, {64, 64}}) {
+        auto tiles = tiled_plane(k, steps, rng);
+        size_t sink = 0, vertices = 0;
+        auto& pool = ThreadPool::instance();
+        std::vector<EarClipper> clippers(pool.size());
+        std::vector<std::vector<uint32_t>> separate(tiles.size());
+        auto plain = nanoseconds_per_call(1, [&](size_t) {
+            pool.parallel_for(tiles.size(), [&](unsigned worker, size_t i) {
+                auto& out = separate[i];
+                out.resize(3 * tiles[i].size());
+                out.resize(triangulate_indices(clippers[worker], tiles[i].data(), tiles[i].size(), out.data()).size);
+            });
+        }) / 1e6;
+        for(auto& t : tiles)
+            vertices += t.size();
+        WeldedMesh mesh;
+        auto welded = nanoseconds_per_call(1, [&](size_t) { mesh = triangulate_welded(tiles, pool); }) / 1e6;
+        sink += mesh.indices.size() + separate[0].size();
+        std::cout << std::setw(5) << tiles.size() << std::setw(13) << 4 * steps << std::setprecision(1) << std::fixed
+                  << std::setw(13) << plain << std::setw(11) << welded << std::setw(10) << vertices
+                  << std::setw(17) << mesh.vertices.size() << (sink ? "" : " ") << "\n";
+        std::cout << std::defaultfloat;
+    }
+}
+
+// The ear set allocates and frees a node per ear even in a warm clipper; a fresh clipper
+// also allocates every list node and array. Bump: a monotonic buffer released after each
+// polygon, the per thread arena pattern.
+void bench_allocators() {
+    std::mt19937_64 rng(23);
+    std::cout << "points  warm_new_us  warm_pool_us  fresh_new_us  fresh_pool_us  fresh_bump_us\n";
+    for(size_t n = 64; n <= 65536; n *= 8) {
+        std::vector<std::vector<Point>> polygons;
+        for(int i = 0; i < 8; ++i)
+            polygons.push_back(star_polygon(n, rng, 100.0));
+        size_t calls = std::max<size_t>(8, (1 << 20) / n), sink = 0;
+        auto run = [&](EarClipper& clipper, size_t i) {
+            auto const& polygon = polygons[i % polygons.size()];
+            clipper.reset(polygon.begin(), polygon.end());
+            clipper.clip([&](Vertex const&, Vertex const&, Vertex const&) { ++sink; });
+        };
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::monotonic_buffer_resource bump;
+        EarClipper warm, warm_pool(&pool);
+        double us[5] = {
+            nanoseconds_per_call(calls, [&](size_t i) { run(warm, i); }),
+            nanoseconds_per_call(calls, [&](size_t i) { run(warm_pool, i); }),
+            nanoseconds_per_call(calls, [&](size_t i) { EarClipper fresh; run(fresh, i); }),
+            nanoseconds_per_call(calls, [&](size_t i) { EarClipper fresh(&pool); run(fresh, i); }),
+            nanoseconds_per_call(calls, [&](size_t i) {
+                {
+                    EarClipper fresh(&bump);
+                    run(fresh, i);
+                }
+                bump.release();
+            }),
+        };
+        int const width[5] = {13, 14, 14, 15, 15};     // the header's columns
+        std::cout << std::setw(6) << n << std::setprecision(1) << std::fixed;
+        for(int k = 0; k < 5; ++k)
+            std::cout << std::setw(width[k]) << us[k] / 1000;
+        std::cout << (sink ? "" : " ") << "\n" << std::defaultfloat;
+    }
+}
+
+// AnonHugePages of this process in MB, -1 where /proc does not say.
+long anon_huge_pages_mb() {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string key;
+    long kb;
+    while(rollup >> key)
+        if(key == "AnonHugePages:" && rollup >> kb)
+            return kb / 1024;
+    return -1;
+}
+
+// dTLB read misses of this thread in user space; -1 where perf_event_open refuses.
+int open_dtlb_counter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+uint64_t read_count(int fd) {
+    uint64_t value = 0;
+    if(fd < 0 || ::read(fd, &value, sizeof value) != sizeof value)
+        return 0;
+    return value;
+}
+
+// The pool on 4 KB pages (threshold never reached) has the same node layout as the huge
+// page one, so their difference is the page size alone. Best of two runs of reset + clip
+// on a fresh clipper; huge_MB is what the kernel actually backed with huge pages.
+void bench_huge_pages() {
+    int tlb = open_dtlb_counter();
+    std::cout << " points   new_ms  pool_ms  huge_ms  new_tlb  pool_tlb  huge_tlb  huge_MB   (tlb: dTLB misses per point)\n";
+    for(size_t n = size_t(1) << 18; n <= size_t(1) << 22; n *= 4) {
+        auto polygon = comb_polygon(n);
+        double ms[3], misses[3];
+        long huge_mb = -1;
+        size_t sink = 0;
+        for(int mode = 0; mode < 3; ++mode) {
+            ms[mode] = misses[mode] = std::numeric_limits<double>::max();
+            for(int run = 0; run < 2; ++run) {
+                HugePageResource::Options options;
+                if(mode == 1)
+                    options.threshold = std::numeric_limits<size_t>::max();
+                HugePagePool memory(options);
+                EarClipper clipper(mode ? memory.resource() : nullptr);
+                auto before = read_count(tlb);
+                auto start = Clock::now();
+                clipper.reset(polygon.begin(), polygon.end());
+                if(mode == 2)
+                    huge_mb = anon_huge_pages_mb();
+                clipper.clip([&](Vertex const&, Vertex const&, Vertex const&) { ++sink; });
+                ms[mode] = std::min(ms[mode], std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                misses[mode] = std::min(misses[mode], double(read_count(tlb) - before) / n);
+            }
+        }
+        std::cout << std::setw(7) << n << std::setprecision(1) << std::fixed;
+        for(auto t : ms)
+            std::cout << std::setw(9) << t;
+        for(int mode = 0; mode < 3; ++mode) {
+            if(tlb >= 0)
+                std::cout << std::setw(mode ? 10 : 9) << std::setprecision(3) << misses[mode];
+            else
+                std::cout << std::setw(mode ? 10 : 9) << "-";
+        }
+        std::cout << std::setw(9) << huge_mb << (sink ? "" : " ") << "\n" << std::defaultfloat;
+    }
+    if(tlb >= 0)
+        ::close(tlb);
+}
+
+// Time the primitives of the reflex index cost model, then pick the ear fraction that
+// minimises total automatic time over the `large` polygons.
+void bench_calibrate() {
+    std::mt19937_64 rng(5);
+    std::uniform_int_distribution<int32_t> coord(0, 1 << 30);
+    constexpr size_t count = 1 << 20;
+    std::vector<Point> points(count);
+    for(auto& p : points)
+        p = {Num(coord(rng)), Num(coord(rng))};
+    Point a{-3, -3}, b{-1, -3}, c{-2, -1};
+    auto box = bounding_box(a, b, c);
+    size_t sink = 0;
+    EarClipper::ReflexIndexCosts costs;
+
+    costs.point = nanoseconds_per_call(1, [&](size_t) {
+        for(auto const& p : points)
+            sink += box.contains(p) && blocks_ear(p, a, b, c);
+    }) / count;
+
+    std::vector<Num> xs;
+    for(auto const& p : points)
+        xs.push_back(p.x);
+    std::sort(xs.begin(), xs.end());
+    constexpr size_t searches = 1 << 18;
+    costs.search_step = nanoseconds_per_call(searches, [&](size_t) {
+        sink += std::lower_bound(xs.begin(), xs.end(), Num(coord(rng))) - xs.begin();
+    }) / std::log2(count);
+
+    ReflexKdTree tree;
+    tree.build(points, [](Point const& p) { return p; });
+    size_t ranges = 0, scanned = 0;
+    constexpr size_t queries = 1 << 16;
+    auto total = nanoseconds_per_call(queries, [&](size_t) {
+        Num x = coord(rng), y = coord(rng);
+        Box q{x, y, x + (1 << 22), y + (1 << 22)};
+        tree.query(q, [&](size_t first, size_t last) {
+            ++ranges;
+            for(auto i = first; i < last; ++i) {
+                scanned++;
+                sink += q.contains(points[i]);
+            }
+            return true;
+        });
+    }) * queries;
+    costs.node = std::max(0.0, (total - costs.point * scanned) / ranges);
+
+    std::vector<std::vector<Point>> polygons;
+    for(size_t n = 256; n <= 16384; n *= 4) {
+        polygons.push_back(star_polygon(n, rng, 100.0));
+        polygons.push_back(comb_polygon(n));
+    }
+    EarClipper clipper;
+    double best_time = 0;
+    auto best_fraction = costs.ear_fraction;
+    for(double fraction : {0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2}) {
+        costs.ear_fraction = fraction;
+        clipper.set_reflex_index_costs(costs);
+        double time = 0;
+        for(auto& polygon : polygons) {
+            time += nanoseconds_per_call(1, [&](size_t) {
+                clipper.reset(polygon.begin(), polygon.end());
+                clipper.clip([&](Vertex const&, Vertex const&, Vertex const&) { ++sink; });
+            });
+        }
+        std::cout << "ear_fraction " << fraction << ": " << std::setprecision(1) << std::fixed << time / 1e6 << " ms\n";
+        if(best_time == 0 || time < best_time) {
+            best_time = time;
+            best_fraction = fraction;
+        }
+        std::cout << std::defaultfloat;
+    }
+    costs.ear_fraction = best_fraction;
+    std::cout << "ReflexIndexCosts{" << std::setprecision(2) << costs.point << ", " << costs.search_step << ", "
+              << costs.node << ", " << costs.ear_fraction << "}" << (sink ? "" : " ") << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto run = [&](char const* section) { return argc < 2 || std::strcmp(argv[1], section) == 0; };
+    if(run("small"))
+        bench_small();
+    if(run("large"))
+        bench_large();
+    if(run("inside"))
+        bench_inside();
+    if(run("locate"))
+        bench_locate();
+    if(run("moments"))
+        bench_moments();
+    if(run("coverage"))
+        bench_coverage();
+    if(run("weld"))
+        bench_weld();
+    if(run("allocators"))
+        bench_allocators();
+    if(argc >= 2 && std::strcmp(argv[1], "hugepages") == 0)
+        bench_huge_pages();
+    if(argc >= 2 && std::strcmp(argv[1], "calibrate") == 0)
+        bench_calibrate();
+    return 0;
+}
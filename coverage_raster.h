@@ -0,0 +1,202 @@
+#ifndef COVERAGE_RASTER_H
+#define COVERAGE_RASTER_H
+/****************************************************************************************
+ * Copper coverage map from triangulated output: the fraction of each square cell of a
+ * grid covered by the triangles, for copper balancing density checks.
+ *
+ * Coverage is exact area, not supersampled: every triangle edge adds its signed area
+ * and cover to the cells it crosses in an accumulation buffer, and a running sum along
+ * each row turns that into the area inside each cell (the scanline scheme of font
+ * rasterisers). Cells inside a triangle cost only the running sum, and the diagonals
+ * shared by two triangles cancel. Triangles of different polygons add up: overlapping
+ * copper must be merged before it is triangulated.
+ *
+ * Exactness is what this buys, not speed: in `benchmark coverage` the raster alone
+ * takes about as long as 4x4 supersampling of the rings (0.3 - 0.45 s for 2^20 points
+ * on 1000 x 1000 cells), and the triangulation comes on top. Supersampling is off by
+ * up to 0.34 - 0.46 of a cell there, on cells that thin star arms cross.
+ *
+ * add_triangles() bins the triangles into bands of rows and fills the bands over the
+ * thread pool, each worker with its own accumulation buffer; a band only writes its
+ * own rows.
+ **/
+
+#include "la2d.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+class CoverageRaster {
+    Point origin;                   // lower left of cell (0, 0)
+    Num cell = 1;                   // side of a cell
+    uint32_t nx = 0, ny = 0;
+    std::vector<double> covered;    // area fraction, row after row
+
+    // Accumulate the part of edge (x0, y0) -> (x1, y1) within rows [0, rows) of `acc`
+    // (rows of nx + 2 entries, x already within [0, nx]), upward edges adding cover.
+    void line(double* acc, size_t rows, double x0, double y0, double x1, double y1) const {
+        if(y0 == y1)
+            return;
+        double dir = 1;
+        if(y0 > y1) {
+            std::swap(x0, x1), std::swap(y0, y1);
+            dir = -1;
+        }
+        auto dxdy = (x1 - x0) / (y1 - y0);
+        auto x = x0;
+        size_t width = nx + 2;
+        for(auto j = size_t(y0); j < rows && j < y1; ++j) {
+            auto* row = acc + j * width;
+            auto dy = std::min(double(j + 1), y1) - std::max(double(j), y0);
+            auto x_next = x + dxdy * dy;
+            auto d = dy * dir;
+            auto [xa, xb] = std::minmax(x, x_next);
+            auto ia = size_t(xa), ib = size_t(std::ceil(xb));
+            if(ib <= ia + 1) {
+                // within one column: the part right of the edge's mean x
+                auto mid = 0.5 * (x + x_next) - double(ia);
+                row[ia] += d - d * mid;
+                row[ia + 1] += d * mid;
+            } else {
+                // across columns: the first and last get triangles, the middle ones
+                // equal slices of the edge's cover
+                auto s = 1 / (xb - xa);
+                auto fa = xa - double(ia);
+                auto first = 0.5 * s * (1 - fa) * (1 - fa);
+                auto fb = xb - double(ib) + 1;
+                auto last = 0.5 * s * fb * fb;
+                row[ia] += d * first;
+                if(ib == ia + 2) {
+                    row[ia + 1] += d * (1 - first - last);
+                } else {
+                    auto second = s * (1.5 - fa);
+                    row[ia + 1] += d * (second - first);
+                    for(auto i = ia + 2; i < ib - 1; ++i)
+                        row[i] += d * s;
+                    auto before_last = second + double(ib - ia - 3) * s;
+                    row[ib - 1] += d * (1 - before_last - last);
+                }
+                row[ib] += d * last;
+            }
+            x = x_next;
+        }
+    }
+
+    // Clip the edge to rows [j0, j1), split it where it leaves the grid on the left or
+    // right and pin those parts to the border: left of the grid an edge still covers
+    // every cell to its right, right of it an edge covers nothing.
+    void edge(double* acc, int64_t j0, int64_t j1, double x0, double y0, double x1, double y1) const {
+        auto lo = double(j0), hi = double(j1);
+        if(y0 == y1 || std::max(y0, y1) <= lo || std::min(y0, y1) >= hi)
+            return;
+        auto ax = x0, ay = y0, bx = x1, by = y1;
+        auto at_y = [&](double y) { return ax + (y - ay) * (bx - ax) / (by - ay); };
+        if(y0 < lo || y0 > hi)
+            y0 = std::clamp(y0, lo, hi), x0 = at_y(y0);
+        if(y1 < lo || y1 > hi)
+            y1 = std::clamp(y1, lo, hi), x1 = at_y(y1);
+        auto width = double(nx);
+        if(std::min(x0, x1) >= 0 && std::max(x0, x1) <= width) {
+            line(acc, size_t(j1 - j0), x0, y0 - lo, x1, y1 - lo);
+            return;
+        }
+        double cuts[4] = {0};               // parameters along the edge
+        int n = 1;
+        for(double border : {0.0, double(nx)}) {
+            auto t = (border - x0) / (x1 - x0);
+            if(t > 0 && t < 1)
+                cuts[n++] = t;
+        }
+        if(n == 3 && cuts[1] > cuts[2])
+            std::swap(cuts[1], cuts[2]);
+        cuts[n++] = 1;
+        for(int k = 0; k + 1 < n; ++k) {
+            auto ta = cuts[k], tb = cuts[k + 1];
+            line(acc, size_t(j1 - j0),
+                 std::clamp(x0 + ta * (x1 - x0), 0.0, width), y0 + ta * (y1 - y0) - lo,
+                 std::clamp(x0 + tb * (x1 - x0), 0.0, width), y0 + tb * (y1 - y0) - lo);
+        }
+    }
+
+public:
+    CoverageRaster() = default;
+    // columns by rows cells of side `cell_size` with lower left corner at `lower_left`.
+    CoverageRaster(Point lower_left, Num cell_size, uint32_t columns, uint32_t rows)
+        : origin(lower_left), cell(cell_size), nx(columns), ny(rows), covered(size_t(columns) * rows, 0) {}
+
+    uint32_t columns() const { return nx; }
+    uint32_t rows() const { return ny; }
+    // covered fraction of cell (i, j), row j counted from the bottom
+    double operator()(uint32_t i, uint32_t j) const { return covered[size_t(j) * nx + i]; }
+    double const* data() const { return covered.data(); }
+    void clear() { std::fill(covered.begin(), covered.end(), 0); }
+
+    // Add the triangles given as 3 indices each into `points` (as triangulate_indices
+    // writes them), bands of `band_rows` rows in parallel.
+    void add_triangles(Point const* points, uint32_t const* indices, size_t index_count,
+                       ThreadPool& pool = ThreadPool::instance(), uint32_t band_rows = 16) {
+        size_t count = index_count / 3;
+        if(count == 0 || ny == 0 || nx == 0)
+            return;
+        band_rows = std::max(1u, band_rows);
+        size_t bands = (ny + band_rows - 1) / band_rows;
+
+        // corners in cell units, once per triangle, clockwise so that the running sums
+        // come out positive
+        std::vector<double> x(index_count), y(index_count);
+        for(size_t t = 0; t < count; ++t) {
+            auto const* c = &indices[3 * t];
+            bool ccw = triangle_area(points[c[0]], points[c[1]], points[c[2]]) > 0;
+            for(int k = 0; k < 3; ++k) {
+                auto const& p = points[c[ccw ? 2 - k : k]];
+                x[3 * t + k] = double(p.x - origin.x) / cell;
+                y[3 * t + k] = double(p.y - origin.y) / cell;
+            }
+        }
+        // two passes over the bands each triangle overlaps: count, then fill
+        std::vector<uint32_t> start(bands + 1, 0), band_triangles;
+        auto visit = [&](auto&& f) {
+            for(size_t t = 0; t < count; ++t) {
+                auto [ylo, yhi] = std::minmax({y[3 * t], y[3 * t + 1], y[3 * t + 2]});
+                if(yhi <= 0 || ylo >= ny || ylo == yhi)
+                    continue;
+                auto b0 = size_t(std::max(0.0, ylo)) / band_rows;
+                auto b1 = std::min(bands - 1, size_t(std::min(yhi, double(ny - 1))) / band_rows);
+                for(auto b = b0; b <= b1; ++b)
+                    f(b, t);
+            }
+        };
+        visit([&](size_t b, size_t) { ++start[b + 1]; });
+        for(size_t b = 0; b < bands; ++b)
+            start[b + 1] += start[b];
+        band_triangles.resize(start.back());
+        auto next = start;
+        visit([&](size_t b, size_t t) { band_triangles[next[b]++] = uint32_t(t); });
+
+        std::vector<std::vector<double>> scratch(pool.size());
+        pool.parallel_for(bands, [&](unsigned worker, size_t b) {
+            if(start[b] == start[b + 1])
+                return;
+            int64_t j0 = b * band_rows, j1 = std::min<int64_t>(ny, j0 + band_rows);
+            size_t width = nx + 2;
+            auto& acc = scratch[worker];
+            acc.assign(size_t(j1 - j0) * width, 0);
+            for(auto k = start[b]; k != start[b + 1]; ++k) {
+                auto const* tx = &x[3 * band_triangles[k]];
+                auto const* ty = &y[3 * band_triangles[k]];
+                for(int e = 0; e < 3; ++e)
+                    edge(acc.data(), j0, j1, tx[e], ty[e], tx[(e + 1) % 3], ty[(e + 1) % 3]);
+            }
+            for(auto j = j0; j < j1; ++j) {
+                auto const* row = &acc[size_t(j - j0) * width];
+                auto* out = &covered[size_t(j) * nx];
+                double sum = 0;
+                for(uint32_t i = 0; i < nx; ++i)
+                    out[i] += sum += row[i];
+            }
+        });
+    }
+};
+#endif
@@ -6,62 +6,327 @@
 
 #include "la2d.h"
 #include "integrate_polygon.h"
+#include "memory_accounting.h"
+#include "reflex_kdtree.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <list>
 #include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <unordered_set>
+#include <vector>
+#if __cpp_impl_coroutine >= 201902L
+#include "generator.h"
+#endif
 
-namespace std {
-template<>
-class hash<list<Point>::iterator> {
-public:
-    size_t operator()(list<Point>::iterator i) const {
-        return hash<Point*>{}(&*i);
-    }
+// Point tagged with its position in the input ring, so clipped triangles can be
+// reported as index triples as well as coordinates.
+struct Vertex : Point {
+    uint32_t index = 0;
+    Num turn = 0;                       // triangle_area(prev, this, next), kept by EarClipper
+    uint32_t reflex_slot = no_slot;     // position in EarClipper's packed reflex points
+    static constexpr uint32_t no_slot = std::numeric_limits<uint32_t>::max();
 };
-}
+using Triangle = std::array<Vertex, 3>;
 
+// Notified around the phases of a run, for profiling (perf_counters.h).
+struct PhaseHooks {
+    enum Phase { load, integrate, find_eartips, clip, output, phases };
+    virtual void begin(Phase phase) = 0;
+    virtual void end() = 0;
+};
 
 class EarClipper {
-    std::list<Point> points;
-    using PointPtr = std::list<Point>::iterator;
-    std::unordered_set<PointPtr> eartip_points;
-    std::unordered_set<PointPtr> concav_points;
+    // Bytes held by the containers below, booked by their CountingAllocators. Held by
+    // pointer so the allocators' reference survives moving the clipper.
+    std::unique_ptr<MemoryAccount> account = std::make_unique<MemoryAccount>();
+    std::pmr::memory_resource* resource = nullptr;  // the containers' memory; null: operator new
+    template<typename T, MemoryAccount::Category C>
+    using Allocator = CountingAllocator<T, C>;
+    template<typename Container>
+    typename Container::allocator_type allocator() const {
+        return typename Container::allocator_type(account.get(), resource);
+    }
+
+    using VertexList = std::list<Vertex, Allocator<Vertex, MemoryAccount::vertices>>;
+    VertexList points{allocator<VertexList>()};
+    VertexList spare{allocator<VertexList>()};      // clipped nodes, recycled by reset()
+    using PointPtr = VertexList::iterator;
+    struct PointPtrHash {
+        size_t operator()(PointPtr i) const { return std::hash<Vertex*>{}(&*i); }
+    };
+    using EartipSet = std::unordered_set<PointPtr, PointPtrHash, std::equal_to<PointPtr>,
+                                         Allocator<PointPtr, MemoryAccount::ear_set>>;
+    EartipSet eartip_points{0, PointPtrHash{}, std::equal_to<PointPtr>{}, allocator<EartipSet>()};
+
+public:
+    // How check_ear finds the reflex points near an ear.
+    enum class ReflexIndex {
+        automatic,  // pick per polygon
+        scan,       // every reflex point (tombstones are rejected by the box test)
+        sorted_x,   // binary search to the ear's x extent, scan that slice only
+        kd_tree,    // k-d tree with live counts, for many or clustered reflex points
+    };
+
+    // Cost model behind ReflexIndex::automatic, in nanoseconds per ear query. An ear is
+    // taken to span `ear_fraction` of the polygon's bounding box in x and y; the index
+    // with the lowest predicted cost for the polygon's reflex count and spread wins.
+    // Defaults come from `benchmark calibrate`.
+    struct ReflexIndexCosts {
+        double point = 2.8;         // box test of one packed point
+        double search_step = 21;    // one step of the binary search on x
+        double node = 47;           // one k-d tree range visited
+        double ear_fraction = 0.05;
+    };
+private:
+    // Reflex points scanned by check_ear, packed contiguously (sorted by x, or in k-d tree
+    // order) and rebased to the bounding box origin: int32_t when the polygon span allows
+    // (cross products are still exact in Num), Num otherwise. Reflex points only ever
+    // become convex, so removal is lazy: the slot's y is set to a value no ear's bounding
+    // box can contain.
+    template<typename Coord>
+    struct PackedPoint {
+        Coord x, y;
+        static constexpr Coord tombstone = std::numeric_limits<Coord>::lowest();
+    };
+    template<typename T>
+    using ReflexVector = std::vector<T, Allocator<T, MemoryAccount::reflex_index>>;
+    ReflexVector<PackedPoint<int32_t>> reflex_narrow{allocator<ReflexVector<PackedPoint<int32_t>>>()};
+    ReflexVector<PackedPoint<Num>> reflex_wide{allocator<ReflexVector<PackedPoint<Num>>>()};
+    ReflexVector<Vertex*> reflex_vertices{allocator<ReflexVector<Vertex*>>()};  // scratch for building the packed arrays
+    Point origin;
+    bool narrow = false;
+    Point span;                             // polygon bounding box size
+    ReflexIndex requested_index = ReflexIndex::automatic, reflex_index = ReflexIndex::scan;
+    ReflexIndexCosts costs;
+    ReflexKdTree kd_tree{account.get(), resource};
+    uint32_t kd_leaf_size = 8;
 
     Num area_from_integral = 0, area_from_triangulation = 0;
+    PhaseHooks* hooks = nullptr;
 
-    bool check_convex(PointPtr p1) {
-        auto p0 = prev(p1);
-        auto p2 = next(p1);
-        auto area = triangle_area(*p0, *p1, *p2); 
+    // cache the turn area of p1; only needed again when a neighbour changes
+    void update_turn(PointPtr p1) {
+        p1->turn = triangle_area(*prev(p1), *p1, *next(p1));
+    }
+
+    bool check_convex(PointPtr p1) const {
+        auto area = p1->turn;
         return area != 0 && area > 0 == area_from_integral > 0;;
     }
 
+    Point rebased(Point const& p) const {
+        return {p.x - origin.x, p.y - origin.y};
+    }
+
+    // Points outside the ear's bounding box (most of them) are rejected before any
+    // orientation test; the x order ends the scan at the box's right side.
+    template<typename Packed>
+    static bool none_inside(Packed const& reflex, size_t first, size_t last, Box const& box,
+                            Point const& a, Point const& b, Point const& c) {
+        for(auto v = reflex.begin() + first; v != reflex.begin() + last; ++v) {
+            Point p{Num(v->x), Num(v->y)};
+            if(box.contains(p) && blocks_ear(p, a, b, c))
+                return false;
+        }
+        return true;
+    }
+
+    template<typename Packed>
+    bool no_reflex_inside(Packed const& reflex, Point const& a, Point const& b, Point const& c) const {
+        auto box = ear_box(a, b, c);
+        if(reflex_index == ReflexIndex::kd_tree) {
+            return kd_tree.query(box, [&](size_t first, size_t last) {
+                return none_inside(reflex, first, last, box, a, b, c);
+            });
+        }
+        auto v = reflex.begin(), end = reflex.end();
+        if(reflex_index == ReflexIndex::sorted_x)
+            v = std::lower_bound(v, end, box.xmin, [](auto const& r, Num x) { return r.x < x; });
+        for(; v != end && v->x <= box.xmax; ++v) {
+            Point p{Num(v->x), Num(v->y)};
+            if(box.contains(p) && blocks_ear(p, a, b, c))
+                return false;
+        }
+        return true;
+    }
+
     bool check_ear (PointPtr p1) {
         auto p0 = prev(p1);
         auto p2 = next(p1);
-        for(auto v : concav_points) {
-            if(inside_triangle(*v, *p0, *p1, *p2))
-                return false;
+        auto a = rebased(*p0), b = rebased(*p1), c = rebased(*p2);
+        return narrow ? no_reflex_inside(reflex_narrow, a, b, c) : no_reflex_inside(reflex_wide, a, b, c);
+    }
+
+    template<typename Packed>
+    void pack_reflex(Packed& reflex) {
+        for(auto v : reflex_vertices) {
+            auto p = rebased(*v);
+            v->reflex_slot = reflex.size();
+            reflex.push_back({decltype(reflex[0].x)(p.x), decltype(reflex[0].y)(p.y)});
         }
-        return true;
+    }
+
+    // Evaluate `costs` for the collected reflex vertices: a scan reads about half of them
+    // before the x order ends it, the x slice reads those within the ear's width, and
+    // the k-d tree descends to the leaves overlapping the ear in both x and y.
+    void choose_reflex_index() {
+        double r = reflex_vertices.size();
+        if(r == 0) {
+            reflex_index = ReflexIndex::scan;
+            return;
+        }
+        Num xmin = reflex_vertices[0]->x, xmax = xmin, ymin = reflex_vertices[0]->y, ymax = ymin;
+        for(auto v : reflex_vertices) {
+            xmin = std::min(xmin, v->x);
+            xmax = std::max(xmax, v->x);
+            ymin = std::min(ymin, v->y);
+            ymax = std::max(ymax, v->y);
+        }
+        // Along one axis an ear spans e = ear_fraction of the polygon. It meets the band w
+        // the reflex points span with probability about e + w, and then covers e / w of it
+        // (both up to 1). Points on one line (w = 0) are met by few ears, not by all.
+        struct Axis {
+            double meet, share;     // share: of all reflex points, averaged over ears
+        };
+        auto axis = [&](Num polygon, Num reflex) {
+            if(polygon <= 0)
+                return Axis{1, 1};
+            double e = costs.ear_fraction, w = double(reflex) / double(polygon);
+            double meet = std::min(1.0, e + w);
+            return Axis{meet, meet * (w > e ? e / w : 1.0)};
+        };
+        auto ax = axis(span.x, xmax - xmin), ay = axis(span.y, ymax - ymin);
+        double fx = ax.share, fy = ay.share;
+
+        double best = costs.point * r / 2;
+        reflex_index = ReflexIndex::scan;
+        double sorted = costs.search_step * std::log2(r + 1) + costs.point * r * fx;
+        if(sorted < best) {
+            best = sorted;
+            reflex_index = ReflexIndex::sorted_x;
+        }
+        // the node extents stop a query that misses the reflex points' box at the root
+        double meet = ax.meet * ay.meet;
+        for(uint32_t leaf : {4, 8, 16, 32}) {
+            double depth = std::log2(r / leaf + 1);
+            double leaves = meet + r * fx * fy / leaf;
+            double kd = costs.node * (1 + meet * depth + leaves) + costs.point * leaf * leaves;
+            if(kd < best) {
+                best = kd;
+                reflex_index = ReflexIndex::kd_tree;
+                kd_leaf_size = leaf;
+            }
+        }
+    }
+
+    // Pick the index, order the collected reflex vertices for it and pack them.
+    void build_reflex_index() {
+        reflex_index = requested_index;
+        kd_leaf_size = 8;
+        if(reflex_index == ReflexIndex::automatic)
+            choose_reflex_index();
+        if(reflex_index == ReflexIndex::kd_tree)
+            kd_tree.build(reflex_vertices, [&](Vertex const* v) { return rebased(*v); }, kd_leaf_size);
+        else
+            std::sort(reflex_vertices.begin(), reflex_vertices.end(),
+                      [](Vertex const* u, Vertex const* v) { return u->x < v->x; });
+        if(narrow)
+            pack_reflex(reflex_narrow);
+        else
+            pack_reflex(reflex_wide);
+    }
+
+    void erase_reflex(Vertex& v) {
+        auto slot = v.reflex_slot;
+        if(slot == Vertex::no_slot)
+            return;
+        if(narrow)
+            reflex_narrow[slot].y = PackedPoint<int32_t>::tombstone;
+        else
+            reflex_wide[slot].y = PackedPoint<Num>::tombstone;
+        if(reflex_index == ReflexIndex::kd_tree)
+            kd_tree.erase(slot);
+        v.reflex_slot = Vertex::no_slot;
+    }
+
+    // Rebase to the bounding box origin and pick the packed coordinate width.
+    void choose_reflex_coordinates() {
+        Point lo = *points.begin(), hi = lo;
+        for(auto const& p : points) {
+            lo = {std::min(lo.x, p.x), std::min(lo.y, p.y)};
+            hi = {std::max(hi.x, p.x), std::max(hi.y, p.y)};
+        }
+        constexpr Num narrow_span = std::numeric_limits<int32_t>::max();
+        span = {hi.x - lo.x, hi.y - lo.y};
+        narrow = use_fixed_point_arithmetic && span.x <= narrow_span && span.y <= narrow_span;
+        origin = use_fixed_point_arithmetic ? lo : Point{};
     }
 
     void find_concave_and_eartips() {
+        choose_reflex_coordinates();
+        for(auto p1 = points.begin(); p1 != points.end(); ++p1)
+            update_turn(p1);
         for(auto p1 = points.begin(); p1 != points.end(); ++p1) {
             if(check_convex(p1))
                 eartip_points.insert(p1); // not ear yet
             else 
-                concav_points.insert(p1); // count middle point of degenerate triangle
+                reflex_vertices.push_back(&*p1); // count middle point of degenerate triangle
         }
+        build_reflex_index();
         // filter out non eartip from convex points
         for(auto itr = eartip_points.begin(); itr != eartip_points.end(); ) {
             if(check_ear(*itr))
                 ++itr;
-            else
+            else 
                 itr = eartip_points.erase(itr);
         }
     }
 
+    // Clip one ear, handing it to emit(p0, p1, p2) unless degenerate; false when done.
+    template<typename Sink>
+    bool clip_ear(Sink& emit) {
+        if(eartip_points.empty() || points.size() < 3)
+            return false;
+        auto itr = eartip_points.begin();
+        auto p1 = *itr;
+        auto p0 = prev(p1);
+        auto p2 = next(p1);
+        auto area = p1->turn;
+        assert(area == 0 || check_convex(p1));
+        if(area) {
+            area_from_triangulation += area;
+            emit(*p0, *p1, *p2);
+        }
+        eartip_points.erase(itr);
+        spare.splice(spare.end(), points, p1);
+        update_turn(p0);
+        update_turn(p2);
+        for(auto p : {p0, p2}) {
+            if(check_convex(p)) {
+                erase_reflex(*p);
+                if(check_ear(p))
+                    eartip_points.insert(p);
+                else
+                    eartip_points.erase(p);
+            } else if(p->turn == 0) {
+                // now collinear with its neighbours: clip it as a degenerate ear, and stop
+                // scanning it (a line of such points would make every ear query O(n))
+                erase_reflex(*p);
+                eartip_points.insert(p);
+            } else {
+                eartip_points.erase(p);
+            }
+        }
+        return true;
+    }
+
     // circular iterator
     PointPtr next(PointPtr itr) {
         if(++itr == points.end()) 
@@ -74,43 +339,152 @@ class EarClipper {
         return --itr;
     }
 public:
-    EarClipper(std::list<Point>&& _points) : points(_points) {
+    EarClipper() = default;
+    // Take all memory from `resource` (jemalloc arena, bump allocator, huge pages...),
+    // which must outlive the clipper.
+    explicit EarClipper(std::pmr::memory_resource* _resource) : resource(_resource) {}
+    EarClipper(std::list<Point>&& _points) {
+        reset(_points.begin(), _points.end());
+    }
+    EarClipper(EarClipper&&) = default;
+    // The containers free their nodes into this clipper's account, so they take over
+    // `other`'s nodes (and allocators) before the account is replaced. A moved-from
+    // clipper may only be destroyed or assigned to.
+    EarClipper& operator=(EarClipper&& other) noexcept {
+        if(this == &other)
+            return *this;
+        points = std::move(other.points);
+        spare = std::move(other.spare);
+        eartip_points = std::move(other.eartip_points);
+        reflex_narrow = std::move(other.reflex_narrow);
+        reflex_wide = std::move(other.reflex_wide);
+        reflex_vertices = std::move(other.reflex_vertices);
+        kd_tree = std::move(other.kd_tree);
+        origin = other.origin;
+        narrow = other.narrow;
+        span = other.span;
+        requested_index = other.requested_index;
+        reflex_index = other.reflex_index;
+        costs = other.costs;
+        kd_leaf_size = other.kd_leaf_size;
+        area_from_integral = other.area_from_integral;
+        area_from_triangulation = other.area_from_triangulation;
+        hooks = other.hooks;
+        account = std::move(other.account);
+        resource = other.resource;
+        return *this;
+    }
+
+    // Choose how check_ear looks up reflex points; takes effect at the next reset().
+    void set_reflex_index(ReflexIndex index) {
+        requested_index = index;
+    }
+    void set_reflex_index_costs(ReflexIndexCosts const& c) {
+        costs = c;
+    }
+    // Report reset()'s phases to `h` (nullptr: none).
+    void set_phase_hooks(PhaseHooks* h) {
+        hooks = h;
+    }
+    // Bytes held by the clipper's structures; peaks restart at every reset().
+    MemoryAccount const& memory() const {
+        return *account;
+    }
+    MemoryAccount& memory() {
+        return *account;
+    }
+    // Where the clipper's memory comes from; null for operator new.
+    std::pmr::memory_resource* memory_resource() const {
+        return resource;
+    }
+    // The index picked for the current polygon (never automatic).
+    ReflexIndex active_reflex_index() const {
+        return reflex_index;
+    }
+
+    // Load a new polygon, reusing list nodes and hash buckets of the previous one.
+    // Points are numbered by position, Vertex input keeps its own indices.
+    template<typename Iterator>
+    void reset(Iterator first, Iterator last) {
+        if(hooks)
+            hooks->begin(PhaseHooks::load);
+        account->start_run();
+        eartip_points.clear();
+        reflex_narrow.clear();
+        reflex_wide.clear();
+        reflex_vertices.clear();
+        area_from_integral = area_from_triangulation = 0;
+        spare.splice(spare.end(), points);
+        [[maybe_unused]] uint32_t count = 0;
+        for(uint32_t index = 0; first != last; ++first, ++index, ++count) {
+            // a repeated point adds a zero length edge and two zero turn "reflex" points
+            // that would block every ear cut through them: keep one
+            if(!points.empty() && points.back().x == first->x && points.back().y == first->y)
+                continue;
+            if(spare.empty())
+                points.emplace_back();
+            else 
+                points.splice(points.end(), spare, spare.begin());
+            static_cast<Point&>(points.back()) = *first;
+            points.back().index = index;
+            if constexpr(std::is_base_of_v<Vertex, typename std::iterator_traits<Iterator>::value_type>)
+                points.back().index = first->index;     // keep caller's indices
+            points.back().reflex_slot = Vertex::no_slot;
+        }
+
+        assert(count >= 3);
         // if given last point = first: remove to cirular iterate with next()
-        if(points.begin()->x == points.rbegin()->x && points.begin()->y == points.rbegin()->y)
-            points.pop_back();  
+        if(points.size() > 1 && points.begin()->x == points.rbegin()->x && points.begin()->y == points.rbegin()->y)
+            spare.splice(spare.end(), points, prev(points.begin()));
 
-        assert(points.size() >= 3);
+        if(hooks)
+            hooks->end(), hooks->begin(PhaseHooks::integrate);
         area_from_integral = integrate_polygon(points);
+        if(hooks)
+            hooks->end(), hooks->begin(PhaseHooks::find_eartips);
         find_concave_and_eartips();
+        if(hooks)
+            hooks->end();
     }
-    void operator()() {
-        while(!eartip_points.empty() && points.size() >= 3) {
-            auto itr = eartip_points.begin();
-            auto p1 = *itr;
-            auto p0 = prev(p1);
-            auto p2 = next(p1);
-            auto area = triangle_area(*p0, *p1, *p2);
-            assert(area == 0 || check_convex(p1));
-            if(area) {
-                area_from_triangulation += area;
-                std::cout << *p0 << std::endl << *p1 << std::endl << *p2 << std::endl << std::endl;
-            }
-            eartip_points.erase(itr);
-            points.erase(p1);
-            for(auto p : {p0, p2}) {
-                if(check_convex(p)) {
-                    concav_points.erase(p);
-                    if(check_ear(p))
-                        eartip_points.insert(p);
-                    else
-                        eartip_points.erase(p);
-                }
+
+    bool area_matches() const {
+        return abs(area_from_triangulation - area_from_integral) <= (use_fixed_point_arithmetic ? 0 : epsilon);
+    }
+
+    // Clip all ears, handing each non-degenerate triangle to emit(p0, p1, p2).
+    template<typename Sink>
+    void clip(Sink&& emit) {
+        while(clip_ear(emit))
+            ;
+    }
+
+#if __cpp_impl_coroutine >= 201902L
+    // Lazily clip ears: the loop is suspended between triangles, so consumers can stop
+    // early or interleave other work. The clipper must outlive the generator.
+    Generator<Triangle> triangles() {
+        Triangle triangle;
+        bool clipped = false;
+        auto keep = [&](Vertex const& p0, Vertex const& p1, Vertex const& p2) {
+            triangle = {p0, p1, p2};
+            clipped = true;
+        };
+        while(clip_ear(keep)) {
+            if(clipped) {
+                clipped = false;
+                co_yield triangle;
             }
         }
+    }
+#endif
+
+    void operator()() {
+        clip([](Vertex const& p0, Vertex const& p1, Vertex const& p2) {
+            std::cout << p0 << std::endl << p1 << std::endl << p2 << std::endl << std::endl;
+        });
         std::cout << "Using " << (use_fixed_point_arithmetic ? "fixed" : "floating") << " point arithmetic\n";
         std::cout << "area_from_integral      = " << std::fixed << std::setprecision(20) << abs(area_from_integral/double(scale)/scale/2.0) << std::endl; 
         std::cout << "area_from_triangulation = " << std::fixed << std::setprecision(20) << abs(area_from_triangulation/double(scale)/scale/2.0) << std::endl; 
-        assert( abs(area_from_triangulation - area_from_integral) <= (use_fixed_point_arithmetic ? 0 : epsilon) );
+        assert(area_matches());
     }
 };
 #endif
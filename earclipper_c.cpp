@@ -0,0 +1,52 @@
+#include "earclipper_c.h"
+#include "small_earclipper.h"
+#include <new>
+
+static_assert(use_fixed_point_arithmetic, "the C interface uses the fixed point layout");
+static_assert(sizeof(Point) == 2 * sizeof(int64_t) && alignof(Point) == alignof(int64_t),
+              "Point must match interleaved int64_t x,y pairs");
+static_assert(EC_SCALE == scale, "EC_SCALE out of sync with la2d.h");
+
+struct ec_context {
+    EarClipper clipper;
+};
+
+uint32_t ec_abi_version(void) noexcept {
+    return EC_ABI_VERSION;
+}
+
+ec_context* ec_context_create(void) noexcept {
+    try {
+        return new ec_context;
+    } catch(...) {
+        return nullptr;
+    }
+}
+
+void ec_context_destroy(ec_context* ctx) noexcept {
+    delete ctx;
+}
+
+ec_status ec_triangulate(ec_context* ctx, const int64_t* xy, size_t n,
+                         uint32_t* out_idx, size_t cap, size_t* out_len) noexcept {
+    if(!ctx || !xy || !out_len || n < 3 || n > UINT32_MAX || (cap && !out_idx))
+        return EC_ERR_INVALID;
+    size_t required = 3 * (n - 2);
+    *out_len = required;
+    if(cap < required)
+        return EC_ERR_CAPACITY;
+
+    auto points = reinterpret_cast<Point const*>(xy);
+    TriangulationResult result;
+    try {
+        result = triangulate_indices(ctx->clipper, points, n, out_idx);
+    } catch(std::bad_alloc const&) {
+        *out_len = 0;
+        return EC_ERR_NOMEM;
+    } catch(...) {
+        *out_len = 0;
+        return EC_ERR_INTERNAL;
+    }
+    *out_len = result.size;
+    return result.complete ? EC_OK : EC_ERR_AREA;
+}
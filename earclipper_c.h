@@ -0,0 +1,53 @@
+#ifndef EARCLIPPER_C_H
+#define EARCLIPPER_C_H
+/****************************************************************************************
+ * C interface to the ear clipper, for C and Rust callers.
+ *
+ * Coordinates are interleaved x,y pairs in the fixed point layout of la2d.h (value
+ * times EC_SCALE). Output is written to caller provided buffers only: on success
+ * *out_len is the number of indices written (3 per triangle); with too small a buffer
+ * nothing is written, EC_ERR_CAPACITY is returned and *out_len holds the capacity
+ * needed. Passing out_idx = NULL, cap = 0 is a valid way to query that capacity.
+ *
+ * A context owns the clipper's scratch memory and is reused across calls. It is not
+ * thread safe: use one context per thread.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#define EC_NOEXCEPT noexcept
+#else
+#define EC_NOEXCEPT
+#endif
+
+#define EC_ABI_VERSION 1
+#define EC_SCALE 10000000
+
+typedef struct ec_context ec_context;
+
+typedef enum ec_status {
+    EC_OK = 0,
+    EC_ERR_INVALID = -1,    /* null argument or fewer than 3 points */
+    EC_ERR_CAPACITY = -2,   /* out_idx too small, *out_len = required capacity */
+    EC_ERR_NOMEM = -3,      /* the context could not grow its scratch memory */
+    EC_ERR_AREA = -4,       /* triangles do not cover the polygon (e.g. self intersecting) */
+    EC_ERR_INTERNAL = -5    /* unexpected failure inside the library; nothing written */
+} ec_status;
+
+/* No C++ exception ever leaves these functions. */
+uint32_t ec_abi_version(void) EC_NOEXCEPT;
+
+/* NULL when out of memory. */
+ec_context* ec_context_create(void) EC_NOEXCEPT;
+void ec_context_destroy(ec_context* ctx) EC_NOEXCEPT;
+
+ec_status ec_triangulate(ec_context* ctx, const int64_t* xy, size_t n,
+                         uint32_t* out_idx, size_t cap, size_t* out_len) EC_NOEXCEPT;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
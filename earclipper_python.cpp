@@ -0,0 +1,139 @@
+/****************************************************************************************
+ * Python bindings (pybind11) over NumPy buffers.
+ *
+ *   c++ -O2 -std=c++17 -shared -fPIC $(python3 -m pybind11 --includes) \
+ *       earclipper_python.cpp -o earclipper$(python3-config --extension-suffix)
+ *
+ * triangulate(points)        points: (n, 2) int64 fixed point or float64 in CSV units
+ *                            returns (m, 3) uint32 vertex indices
+ * triangulate_batch(points, offsets)
+ *                            ragged batch: polygon i is points[offsets[i]:offsets[i+1]]
+ *                            returns (indices (m, 3) uint32, triangle offsets (k+1,) int64)
+ *                            with indices local to each polygon
+ *
+ * C contiguous int64 input is read in place as Point arrays, other int64 layouts are
+ * copied; float64 input is rounded to fixed point as read_from_file() does. The GIL is
+ * released while triangulating, and batches run on the shared ThreadPool with one warm
+ * EarClipper per worker.
+ *
+ * Unverified: pybind11 and NumPy were not available where this was written, so the
+ * module has never been compiled or imported. The headers it includes build with
+ * -std=c++17, the minimum above.
+ **/
+
+#include "small_earclipper.h"
+#include "parallel.h"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <stdexcept>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+using Indices = std::vector<uint32_t>;
+
+// Points viewed in place in a C contiguous int64 array (the input or a copy of it), or
+// converted from float64 into `storage`.
+struct PointSpan {
+    Point const* data = nullptr;
+    size_t size = 0;
+    py::array_t<int64_t, py::array::c_style | py::array::forcecast> fixed;
+    std::vector<Point> storage;
+};
+
+PointSpan as_points(py::array const& array) {
+    if(array.ndim() != 2 || array.shape(1) != 2)
+        throw std::invalid_argument("points must have shape (n, 2)");
+    PointSpan span;
+    span.size = array.shape(0);
+    if(use_fixed_point_arithmetic && py::isinstance<py::array_t<int64_t>>(array)) {
+        // no copy when already C contiguous; slices and Fortran order are copied
+        span.fixed = py::array_t<int64_t, py::array::c_style | py::array::forcecast>::ensure(array);
+        if(!span.fixed)
+            throw std::invalid_argument("points must be numeric");
+        span.data = reinterpret_cast<Point const*>(span.fixed.data());
+        return span;
+    }
+    auto values = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure(array);
+    if(!values)
+        throw std::invalid_argument("points must be numeric");
+    span.storage.resize(span.size);
+    auto xy = values.data();
+    for(size_t i = 0; i < span.size; ++i)
+        span.storage[i] = {from_units(xy[2*i]), from_units(xy[2*i+1])};
+    span.data = span.storage.data();
+    return span;
+}
+
+void triangulate_into(EarClipper& clipper, Point const* points, size_t n, Indices& out) {
+    out.clear();
+    if(n < 3)
+        return;
+    out.resize(3 * (n - 2));
+    out.resize(triangulate_indices(clipper, points, n, out.data()).size);
+}
+
+// Hand a vector to NumPy without copying; the capsule owns it.
+template<typename T>
+py::array_t<T> to_numpy(std::vector<T>&& values, size_t columns) {
+    auto owner = new std::vector<T>(std::move(values));
+    py::capsule free_when_done(owner, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    auto rows = owner->size() / columns;
+    if(columns == 1)
+        return py::array_t<T>({rows}, owner->data(), free_when_done);
+    return py::array_t<T>({rows, columns}, owner->data(), free_when_done);
+}
+
+py::array_t<uint32_t> triangulate(py::array const& array) {
+    auto points = as_points(array);
+    Indices indices;
+    {
+        py::gil_scoped_release release;
+        thread_local EarClipper clipper;
+        triangulate_into(clipper, points.data, points.size, indices);
+    }
+    return to_numpy(std::move(indices), 3);
+}
+
+py::tuple triangulate_batch(py::array const& array, py::array_t<int64_t, py::array::c_style | py::array::forcecast> offsets) {
+    auto points = as_points(array);
+    if(offsets.ndim() != 1 || offsets.shape(0) < 1)
+        throw std::invalid_argument("offsets must have shape (k + 1,)");
+    size_t count = offsets.shape(0) - 1;
+    auto bounds = offsets.data();
+    for(size_t i = 0; i < count; ++i) {
+        if(bounds[i] < 0 || bounds[i] > bounds[i+1] || size_t(bounds[i+1]) > points.size)
+            throw std::invalid_argument("offsets must be non-decreasing and within points");
+    }
+
+    std::vector<Indices> results(count);
+    std::vector<int64_t> triangle_offsets(count + 1, 0);
+    Indices indices;
+    {
+        py::gil_scoped_release release;
+        auto& pool = ThreadPool::instance();
+        std::vector<EarClipper> clippers(pool.size());
+        pool.parallel_for(count, [&](unsigned worker, size_t i) {
+            triangulate_into(clippers[worker], points.data + bounds[i], bounds[i+1] - bounds[i], results[i]);
+        });
+        for(size_t i = 0; i < count; ++i)
+            triangle_offsets[i+1] = triangle_offsets[i] + results[i].size() / 3;
+        indices.reserve(3 * triangle_offsets[count]);
+        for(auto& r : results)
+            indices.insert(indices.end(), r.begin(), r.end());
+    }
+    return py::make_tuple(to_numpy(std::move(indices), 3), to_numpy(std::move(triangle_offsets), 1));
+}
+
+} // namespace
+
+PYBIND11_MODULE(earclipper, m) {
+    m.doc() = "Ear clipping triangulation of fixed point polygons";
+    m.attr("scale") = scale;
+    m.def("triangulate", &triangulate, py::arg("points"),
+          "Triangulate one polygon given as an (n, 2) array; returns (m, 3) uint32 indices.");
+    m.def("triangulate_batch", &triangulate_batch, py::arg("points"), py::arg("offsets"),
+          "Triangulate polygons points[offsets[i]:offsets[i+1]] on the native thread pool.");
+}
@@ -0,0 +1,93 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+/****************************************************************************************
+ * Minimal C++20 coroutine generator (stand-in for std::generator).
+ *
+ *   Generator<int> count() { for(int i = 0; ; ++i) co_yield i; }
+ *   for(int i : count()) if(i > 3) break;
+ *
+ * Values are produced lazily; destroying the generator early simply drops the
+ * suspended coroutine. Exceptions thrown by the body propagate from begin()/operator++.
+ **/
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+template<typename T>
+class Generator {
+public:
+    struct promise_type {
+        T const* value = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T const& v) noexcept {
+            value = &v;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { error = std::current_exception(); }
+        template<typename U>
+        std::suspend_never await_transform(U&&) = delete;
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+        Handle handle;
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(Handle h) : handle(h) {}
+        T const& operator*() const { return *handle.promise().value; }
+        T const* operator->() const { return handle.promise().value; }
+        iterator& operator++() {
+            resume(handle);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+    };
+
+    Generator() = default;
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if(this != &other) {
+            if(handle)
+                handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Generator() {
+        if(handle)
+            handle.destroy();
+    }
+
+    iterator begin() {
+        resume(handle);
+        return iterator{handle};
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    Handle handle;
+    explicit Generator(Handle h) : handle(h) {}
+
+    static void resume(Handle h) {
+        if(!h || h.done())
+            return;
+        h.resume();
+        if(h.promise().error)
+            std::rethrow_exception(std::exchange(h.promise().error, nullptr));
+    }
+};
+#endif
@@ -0,0 +1,127 @@
+#ifndef HUGE_PAGES_H
+#define HUGE_PAGES_H
+/****************************************************************************************
+ * Huge page backed memory for multi-million vertex polygons, whose vertex list, ear set
+ * and reflex arrays span far more than the TLB covers with 4 KB pages.
+ *
+ * HugePageResource maps every allocation of at least `threshold` bytes on its own 2 MB
+ * aligned range: explicit huge pages (MAP_HUGETLB, from the kernel's reserved pool) if
+ * asked for and available, else transparent huge pages via madvise(MADV_HUGEPAGE).
+ * Smaller allocations go to the upstream resource. Vertices and ear set entries are
+ * single list and hash nodes, so HugePagePool puts a pool resource in front, which
+ * carves them out of chunks that grow into huge page sizes:
+ *
+ *     HugePagePool memory;
+ *     EarClipper clipper(memory.resource());
+ *
+ * Not thread safe, like the pool resources it sits behind: one per worker.
+ **/
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <sys/mman.h>
+
+class HugePageResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t huge_page = size_t(2) << 20;
+
+    struct Options {
+        size_t threshold = huge_page;   // smaller allocations go upstream
+        bool explicit_pages = false;    // try MAP_HUGETLB before transparent huge pages
+    };
+
+private:
+    Options options;
+    std::pmr::memory_resource* upstream;
+    size_t mapped_bytes = 0, explicit_bytes = 0;   // now; ever with MAP_HUGETLB
+
+    static size_t round_up(size_t bytes) {
+        return (bytes + huge_page - 1) / huge_page * huge_page;
+    }
+
+    // Huge page aligned anonymous memory: over-map by a page and trim both ends.
+    static void* map_aligned(size_t size) {
+        auto* raw = static_cast<char*>(mmap(nullptr, size + huge_page, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if(raw == MAP_FAILED)
+            return nullptr;
+        auto* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + huge_page - 1) & ~(huge_page - 1));
+        size_t head = aligned - raw;
+        if(head)
+            munmap(raw, head);
+        munmap(aligned + size, huge_page - head);  // head < huge_page: never empty
+        return aligned;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if(bytes < options.threshold || alignment > huge_page)
+            return upstream->allocate(bytes, alignment);
+        auto size = round_up(bytes);
+        void* p = nullptr;
+#ifdef MAP_HUGETLB
+        if(options.explicit_pages) {
+            p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(p == MAP_FAILED)
+                p = nullptr;        // pool empty or not configured: fall back to THP
+            else
+                explicit_bytes += size;
+        }
+#endif
+        if(!p) {
+            p = map_aligned(size);
+            if(!p)
+                throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            madvise(p, size, MADV_HUGEPAGE);    // advice only: 4 KB pages still work
+#endif
+        }
+        mapped_bytes += size;
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        if(bytes < options.threshold || alignment > huge_page)
+            return upstream->deallocate(p, bytes, alignment);
+        // explicit pages and THP ranges unmap alike
+        auto size = round_up(bytes);
+        munmap(p, size);
+        mapped_bytes -= size;
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    HugePageResource() : HugePageResource(Options{}) {}
+    explicit HugePageResource(Options o, std::pmr::memory_resource* up = std::pmr::new_delete_resource())
+        : options(o), upstream(up) {}
+    HugePageResource(HugePageResource const&) = delete;
+    HugePageResource& operator=(HugePageResource const&) = delete;
+
+    // Bytes mapped for huge pages now, and in total so far with MAP_HUGETLB.
+    size_t mapped() const { return mapped_bytes; }
+    size_t explicit_mapped_total() const { return explicit_bytes; }
+};
+
+// Pool of small blocks over a HugePageResource. The pool's default chunk limit keeps
+// chunks near 1 MB, below any huge page; unlimited, they double up to multi MB.
+class HugePagePool {
+    HugePageResource huge;
+    std::pmr::unsynchronized_pool_resource pool;
+
+    static std::pmr::pool_options unlimited_chunks() {
+        std::pmr::pool_options options;
+        options.max_blocks_per_chunk = size_t(1) << 30;
+        return options;
+    }
+
+public:
+    explicit HugePagePool(HugePageResource::Options o = {}) : huge(o), pool(unlimited_chunks(), &huge) {}
+
+    std::pmr::memory_resource* resource() { return &pool; }
+    HugePageResource const& pages() const { return huge; }
+};
+#endif
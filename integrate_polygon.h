@@ -10,8 +10,9 @@ Num integrate_polygon (PointList const& points) {
         auto p1 = points.begin(), p0 = p1++;
         do {
             total += (p0->y + p1->y) * (p1->x - p0->x);
-            p0 = next(p0);
-            p1 = next(p1);
+            p0 = p1;
+            if(++p1 == points.end())
+                p1 = points.begin();
         } while(p0 != points.begin());
     }
     return -total;  // negate so positive area for ccw polygon
@@ -9,13 +9,17 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <cmath>
+#include <type_traits>
 
 constexpr bool use_fixed_point_arithmetic = true; 
 constexpr int scale = use_fixed_point_arithmetic ? 10'000'000 : 1;
 template<bool T>
 using NumType = std::conditional_t<T, int64_t, double>;
 using Num = NumType<use_fixed_point_arithmetic>;
+using WideNum = std::conditional_t<use_fixed_point_arithmetic, __int128, long double>;   // products of two Num
 constexpr Num epsilon = use_fixed_point_arithmetic ? 0 : Num(1e-8);
+constexpr Num snap_grid = use_fixed_point_arithmetic ? 1 : Num(1e-7);  // snap_rounding.h: the fixed point resolution
 
 /****************************************************************************************
  * Some simple linear algebra utilities for 2D points/vectors
@@ -25,22 +29,29 @@ struct Point {
 };
 using Vector = Point;
 
-inline Vector operator-(Point const& a, Point const& b) {
+constexpr bool operator==(Point const& a, Point const& b) {
+    return a.x == b.x && a.y == b.y;
+}
+constexpr bool operator!=(Point const& a, Point const& b) {
+    return !(a == b);
+}
+
+constexpr Vector operator-(Point const& a, Point const& b) {
     return {b.x - a.x, b.y - a.y};
 }
 
-inline Num cross_product(Vector const& a, Vector const& b) {
+constexpr Num cross_product(Vector const& a, Vector const& b) {
     return a.x*b.y - a.y*b.x;
 }
 
-inline Num triangle_area(Point const& a, Point const& b, Point const& c) {
+constexpr Num triangle_area(Point const& a, Point const& b, Point const& c) {
     auto area = cross_product(b-a, c-a);
-    if(abs(area) <= epsilon)
+    if((area < 0 ? -area : area) <= epsilon)
         area = 0;
     return area;
 }
 
-inline bool in_close_interval(Num n, Num a, Num b) {
+constexpr bool in_close_interval(Num n, Num a, Num b) {
     return a <= b ?
         (n >= a && n <= b):
         (n >= b && n <= a);
@@ -49,7 +60,7 @@ inline bool in_close_interval(Num n, Num a, Num b) {
 // Consider point coincident with edge end points as NOT inside triangle.
 // This allows for polygons with holes where holes are connected to outer polygon
 // via conincident edges of opposite directions (e.g. square_disk.csv)
-inline bool inside_triangle(Point const& v, Point const& a, Point const& b, Point const& c) {
+constexpr bool inside_triangle(Point const& v, Point const& a, Point const& b, Point const& c) {
     auto vab = triangle_area(v, a, b);
     if(vab == 0)
         return false;
@@ -67,6 +78,68 @@ inline bool inside_triangle(Point const& v, Point const& a, Point const& b, Poin
     
     return (vbc > 0 == vca > 0);
 }
+
+// Does v keep abc from being clipped as an ear: inside the triangle by the rule of
+// inside_triangle, or on the open diagonal ca the ear would cut (the cut would touch the
+// boundary at v). All orientations are evaluated and combined without data dependent
+// branches.
+constexpr bool blocks_ear(Point const& v, Point const& a, Point const& b, Point const& c) {
+    auto vab = triangle_area(v, a, b);
+    auto vbc = triangle_area(v, b, c);
+    auto vca = triangle_area(v, c, a);
+    bool inside = ((vab > 0) & (vbc > 0) & (vca > 0)) | ((vab < 0) & (vbc < 0) & (vca < 0));
+    // collinear with c and a: strictly between them iff (v - a) . (c - v) > 0
+    bool on_diagonal = (vca == 0) & ((v.x - a.x) * (c.x - v.x) + (v.y - a.y) * (c.y - v.y) > 0);
+    return inside | on_diagonal;
+}
+
+constexpr bool on_segment(Point const& v, Point const& a, Point const& b) {
+    return triangle_area(a, b, v) == 0 && in_close_interval(v.x, a.x, b.x) && in_close_interval(v.y, a.y, b.y);
+}
+
+// Do the closed segments ab and cd share a point?
+constexpr bool segments_intersect(Point const& a, Point const& b, Point const& c, Point const& d) {
+    auto abc = triangle_area(a, b, c), abd = triangle_area(a, b, d);
+    auto cda = triangle_area(c, d, a), cdb = triangle_area(c, d, b);
+    if(((abc > 0 && abd < 0) || (abc < 0 && abd > 0)) && ((cda > 0 && cdb < 0) || (cda < 0 && cdb > 0)))
+        return true;
+    return on_segment(c, a, b) || on_segment(d, a, b) || on_segment(a, c, d) || on_segment(b, c, d);
+}
+
+// Axis aligned bounding box, closed on all sides.
+struct Box {
+    Num xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+
+    constexpr bool contains(Point const& p) const {
+        return (p.x >= xmin) & (p.x <= xmax) & (p.y >= ymin) & (p.y <= ymax);
+    }
+};
+
+constexpr Box bounding_box(Point const& a, Point const& b, Point const& c) {
+    auto lo = [](Num u, Num v, Num w) { return u < v ? (u < w ? u : w) : (v < w ? v : w); };
+    auto hi = [](Num u, Num v, Num w) { return u > v ? (u > w ? u : w) : (v > w ? v : w); };
+    return {lo(a.x, b.x, c.x), lo(a.y, b.y, c.y), hi(a.x, b.x, c.x), hi(a.y, b.y, c.y)};
+}
+
+// Where a point that blocks_ear(v, a, b, c) can be: the triangle's interior and its open
+// cut ca lie strictly inside the bounding box, unless the cut runs along a side. Points on
+// the box's edge (notches level with a long thin ear) are thereby never visited.
+inline Box ear_box(Point const& a, Point const& b, Point const& c) {
+    auto box = bounding_box(a, b, c);
+    auto open = [](Num& lo, Num& hi) {
+        if constexpr(use_fixed_point_arithmetic) {
+            ++lo, --hi;
+        } else {
+            auto l = lo;
+            lo = std::nextafter(lo, hi), hi = std::nextafter(hi, l);
+        }
+    };
+    if(a.x != c.x)
+        open(box.xmin, box.xmax);
+    if(a.y != c.y)
+        open(box.ymin, box.ymax);
+    return box;
+}
 /****************************************************************************************/
 
 
@@ -74,6 +147,16 @@ inline bool inside_triangle(Point const& v, Point const& a, Point const& b, Poin
 inline std::ostream& operator <<(std::ostream& os, Point const& p) {
     return os << double(p.x)/scale << "," << double(p.y)/scale;
 }
+// A coordinate in input (CSV) units as Num: rounded (not truncated) to the nearest fixed
+// point step, so every reader gives the same polygon and write_to_file output reads back
+// exactly.
+inline Num from_units(double v) {
+    if constexpr(use_fixed_point_arithmetic)
+        return Num(std::llround(v * scale));
+    else
+        return Num(v * scale);
+}
+
 template<typename List>
 void read_from_file(char const* filename, List& points) {
     std::ifstream file(filename);
@@ -82,7 +165,33 @@ void read_from_file(char const* filename, List& points) {
         double x, y;
         file >> x >> comma >> y;
         if(file)
-            points.push_back({Num(x*scale),Num(y*scale)});
+            points.push_back({from_units(x), from_units(y)});
+    }
+}
+
+// One "x,y" line per point, in read_from_file's format: exact decimals in fixed point,
+// round trip precision in floating point.
+template<typename Iterator>
+void write_to_file(std::ostream& os, Iterator first, Iterator last) {
+    auto put = [&](auto v) {
+        if constexpr(use_fixed_point_arithmetic) {
+            int digits = 0;
+            for(auto s = scale; s > 1; s /= 10)
+                ++digits;
+            if(v < 0)
+                os << '-', v = -v;
+            os << v / scale;
+            if(digits)
+                os << '.' << std::setw(digits) << std::setfill('0') << v % scale << std::setfill(' ');
+        } else {
+            os << std::setprecision(17) << v;
+        }
+    };
+    for(; first != last; ++first) {
+        put(first->x);
+        os << ',';
+        put(first->y);
+        os << '\n';
     }
 }
 /****************************************************************************************/
@@ -0,0 +1,145 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+/****************************************************************************************
+ * Per polygon triangulation latency for batch runs and the service.
+ *
+ * LatencyHistogram is log linear in the manner of HdrHistogram: 32 sub-buckets per
+ * power of two, so any percentile is within 1/32 (3%) of the recorded value, in a
+ * fixed 15 KB array with O(1) recording. LatencyRecorder keeps one histogram per vertex
+ * count bucket (powers of 4) and writes every polygon slower than a threshold as a CSV
+ * that read_from_file() reads back exactly. Recorders are not thread safe: keep one per
+ * worker and merge() them for the report.
+ **/
+
+#include "la2d.h"
+#include "size_bucket.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+
+class LatencyHistogram {
+    static constexpr int sub_bits = 5, sub = 1 << sub_bits;
+    std::array<uint64_t, sub * (64 - sub_bits + 1)> counts{};
+    uint64_t total = 0, largest = 0;
+
+    static size_t index_of(uint64_t v) {
+        if(v < sub)
+            return v;
+        int shift = 63 - __builtin_clzll(v) - sub_bits;
+        return sub * (shift + 1) + (v >> shift) - sub;
+    }
+    // largest value sharing the bucket
+    static uint64_t value_of(size_t index) {
+        if(index < sub)
+            return index;
+        int shift = int(index / sub) - 1;
+        return ((uint64_t(sub + index % sub) + 1) << shift) - 1;
+    }
+
+public:
+    void record(uint64_t v) {
+        ++counts[index_of(v)];
+        ++total;
+        largest = std::max(largest, v);
+    }
+    void merge(LatencyHistogram const& other) {
+        for(size_t i = 0; i < counts.size(); ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        largest = std::max(largest, other.largest);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return largest; }
+
+    // Smallest recorded value v (to bucket precision) with a fraction q of values <= v.
+    uint64_t percentile(double q) const {
+        if(total == 0)
+            return 0;
+        auto rank = std::max<uint64_t>(1, uint64_t(std::ceil(q * total)));
+        uint64_t seen = 0;
+        for(size_t i = 0; i < counts.size(); ++i)
+            if((seen += counts[i]) >= rank)
+                return std::min(value_of(i), largest);
+        return largest;
+    }
+};
+
+class LatencyRecorder {
+public:
+    struct Options {
+        uint64_t slow_ns = 0;       // capture polygons slower than this; 0: never
+        std::string slow_dir = ".";
+    };
+
+private:
+    Options options;
+    std::map<size_t, LatencyHistogram> buckets;     // by smallest vertex count in the bucket
+    uint64_t captured = 0;
+
+    void capture(Point const* points, size_t n, uint64_t ns) {
+        static std::atomic<uint64_t> sequence{0};
+        auto name = options.slow_dir + "/slow_" + std::to_string(sequence++) + "_" + std::to_string(n) +
+                    "pts_" + std::to_string(ns / 1000) + "us.csv";
+        std::ofstream file(name);
+        write_to_file(file, points, points + n);
+        if(file)
+            ++captured;
+    }
+
+public:
+    LatencyRecorder() = default;
+    explicit LatencyRecorder(Options o) : options(std::move(o)) {}
+
+    void record(Point const* points, size_t n, uint64_t ns) {
+        buckets[SizeBucket::of(n)].record(ns);
+        if(options.slow_ns && ns > options.slow_ns)
+            capture(points, n, ns);
+    }
+
+    // Run triangulate() on the polygon, recording how long it took; returns its result.
+    template<typename F>
+    auto time(Point const* points, size_t n, F&& triangulate) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = triangulate();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        record(points, n, uint64_t(ns));
+        return result;
+    }
+
+    void merge(LatencyRecorder const& other) {
+        for(auto const& [lower, histogram] : other.buckets)
+            buckets[lower].merge(histogram);
+        captured += other.captured;
+    }
+
+    uint64_t captured_polygons() const { return captured; }
+    LatencyHistogram const* histogram(size_t points) const {
+        auto found = buckets.find(SizeBucket::of(points));
+        return found == buckets.end() ? nullptr : &found->second;
+    }
+
+    // One line per vertex count bucket: polygons, p50, p99, p99.9 and max in microseconds.
+    void report(std::ostream& os) const {
+        os << "      points  polygons       p50_us       p99_us      p999_us       max_us\n";
+        for(auto const& [lower, h] : buckets) {
+            os << std::setw(12) << SizeBucket::range(lower) << std::setw(10) << h.count() << std::fixed << std::setprecision(1);
+            for(auto v : {h.percentile(0.5), h.percentile(0.99), h.percentile(0.999), h.max()})
+                os << std::setw(13) << v / 1000.0;
+            os << std::defaultfloat << "\n";
+        }
+        if(options.slow_ns)
+            os << captured << " polygons over " << options.slow_ns / 1000.0 << " us written to "
+               << options.slow_dir << "\n";
+    }
+};
+#endif
@@ -1,14 +1,152 @@
 #include "earclipper.h"
+#include "latency_histogram.h"
+#include "perf_counters.h"
+#include "self_intersection.h"
+#include "snap_rounding.h"
+#include "triangulation_server.h"
+#include <cstdlib>
+#include <cstring>
+
+static volatile std::sig_atomic_t stop_serving = 0;
+
+// Take --slow-us N and --slow-dir DIR from argv[first...], returning the next argument.
+static int latency_options(int argc, char** argv, int first, LatencyRecorder::Options& options) {
+    while(first + 1 < argc) {
+        if(std::strcmp(argv[first], "--slow-us") == 0)
+            options.slow_ns = std::strtoull(argv[first + 1], nullptr, 10) * 1000;
+        else if(std::strcmp(argv[first], "--slow-dir") == 0)
+            options.slow_dir = argv[first + 1];
+        else
+            break;
+        first += 2;
+    }
+    return first;
+}
 
 int main (int argc, char** argv) {
     using namespace std;
+    if(argc >= 3 && strcmp(argv[1], "--serve") == 0) {
+        LatencyRecorder::Options options;
+        if(latency_options(argc, argv, 3, options) != argc) {
+            cerr << "Unknown option " << argv[argc - 1] << "\n";
+            return 1;
+        }
+        signal(SIGINT, [](int) { stop_serving = 1; });
+        signal(SIGTERM, [](int) { stop_serving = 1; });
+        triangulation_service::Server server(argv[2], options);
+        if(!server.listening())
+            return 1;
+        server.run(stop_serving);
+        unlink(argv[2]);
+        server.latency().report(cerr);
+        return 0;
+    }
+    if(argc >= 3 && strcmp(argv[1], "--latency") == 0) {
+        LatencyRecorder::Options options;
+        auto first = latency_options(argc, argv, 2, options);
+        LatencyRecorder recorder(options);
+        EarClipper clipper;
+        vector<uint32_t> indices;
+        for(int file = first; file < argc; ++file) {
+            vector<Point> points;
+            read_from_file(argv[file], points);
+            if(points.size() < 3)
+                continue;
+            indices.resize(3 * points.size());
+            recorder.time(points.data(), points.size(), [&] {
+                return triangulate_indices(clipper, points.data(), points.size(), indices.data());
+            });
+        }
+        recorder.report(cout);
+        return 0;
+    }
+    if(argc == 3 && strcmp(argv[1], "--check") == 0) {
+        list<Point> points;
+        read_from_file(argv[2], points);
+        auto found = find_self_intersection(points.begin(), points.end());
+        if(!found.found) {
+            cout << "simple\n";
+            return 0;
+        }
+        cout << "edges " << found.first << " and " << found.second << " intersect\n";
+        return 1;
+    }
+    if(argc >= 3 && strcmp(argv[1], "--perf-counters") == 0) {
+        PhaseProfile profile;
+        EarClipper clipper;
+        clipper.set_phase_hooks(&profile);
+        vector<Triangle> triangles;
+        for(int file = 2; file < argc; ++file) {
+            profile.begin(PhaseHooks::load);
+            list<Point> points;
+            read_from_file(argv[file], points);
+            profile.end();
+            if(points.size() < 3)
+                continue;
+            clipper.reset(points.begin(), points.end());
+            profile.begin(PhaseHooks::clip);
+            triangles.clear();
+            clipper.clip([&](Vertex const& p0, Vertex const& p1, Vertex const& p2) { triangles.push_back({p0, p1, p2}); });
+            profile.end();
+            profile.begin(PhaseHooks::output);
+            for(auto const& t : triangles)
+                cout << t[0] << "\n" << t[1] << "\n" << t[2] << "\n\n";
+            cout.flush();
+            profile.end();
+            profile.finish_polygon(points.size());
+        }
+        profile.report(cerr);
+        return 0;
+    }
+    if(argc >= 3 && strcmp(argv[1], "--memory") == 0) {
+        EarClipper clipper;
+        auto& account = clipper.memory();
+        vector<uint32_t, CountingAllocator<uint32_t, MemoryAccount::output>> indices{
+            CountingAllocator<uint32_t, MemoryAccount::output>(&account)};
+        size_t batch_peak = 0;
+        double batch_per_vertex = 0;
+        for(int file = 2; file < argc; ++file) {
+            vector<Point> points;
+            read_from_file(argv[file], points);
+            if(points.size() < 3)
+                continue;
+            indices.clear();
+            indices.shrink_to_fit();
+            account.start_run();
+            indices.resize(3 * points.size());
+            indices.resize(triangulate_indices(clipper, points.data(), points.size(), indices.data()).size);
+            cout << argv[file] << ": " << points.size() << " points, ";
+            account.report(cout, points.size());
+            if(account.total_peak > batch_peak) {
+                batch_peak = account.total_peak;
+                batch_per_vertex = double(batch_peak) / points.size();
+            }
+        }
+        // scratch is kept across runs, so the batch peak is that of its largest run
+        cout << "batch: peak " << batch_peak << " bytes, " << fixed << setprecision(1)
+             << batch_per_vertex << " per vertex in its largest run\n";
+        return 0;
+    }
     if(argc != 2) {
-        cerr << "Usage: " << argv[0] << " polygon_csv_filename\n";
+        cerr << "Usage: " << argv[0] << " polygon_csv_filename\n"
+             << "       " << argv[0] << " --check polygon_csv_filename\n"
+             << "       " << argv[0] << " --serve unix_socket_path [--slow-us N] [--slow-dir DIR]\n"
+             << "       " << argv[0] << " --latency [--slow-us N] [--slow-dir DIR] polygon_csv_filename...\n"
+             << "       " << argv[0] << " --perf-counters polygon_csv_filename...\n"
+             << "       " << argv[0] << " --memory polygon_csv_filename...\n";
         return 1;
     }
 
     list<Point> points;
     read_from_file(argv[1], points);
+    if constexpr(!use_fixed_point_arithmetic) {
+        auto ring = snap_round(points.begin(), points.end());
+        if(ring.points.empty()) {
+            cout << "no triangles: the polygon has no area\n";
+            return 0;
+        }
+        points.assign(ring.points.begin(), ring.points.end());
+    }
     EarClipper clipper(std::move(points));
     clipper();
 
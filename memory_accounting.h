@@ -0,0 +1,116 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+/****************************************************************************************
+ * Byte accounting for the triangulator's containers, to size worker pools from measured
+ * rather than guessed memory needs.
+ *
+ * Containers take a CountingAllocator tagged with a category; it books every allocation
+ * to a MemoryAccount (current and peak bytes, per category and in total) and takes the
+ * memory itself from a std::pmr::memory_resource, if given one (arenas, bump or huge page
+ * allocators), else from operator new. An account belongs to one EarClipper, so one
+ * thread: the counters are plain integers. For a batch, merge() the per worker accounts:
+ * peaks add up, since the workers hold their memory at the same time.
+ **/
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <type_traits>
+
+struct MemoryAccount {
+    enum Category { vertices, ear_set, reflex_index, output, categories };
+    static constexpr char const* category_names[categories] = {"vertices", "ear_set", "reflex_index", "output"};
+
+    size_t current[categories] = {}, peak[categories] = {};
+    size_t total = 0, total_peak = 0;
+
+    void allocate(Category c, size_t bytes) {
+        current[c] += bytes;
+        peak[c] = std::max(peak[c], current[c]);
+        total += bytes;
+        total_peak = std::max(total_peak, total);
+    }
+    void deallocate(Category c, size_t bytes) {
+        current[c] -= bytes;
+        total -= bytes;
+    }
+
+    // Start measuring a new run: peaks from what is held now (retained capacity counts).
+    void start_run() {
+        std::copy(current, current + categories, peak);
+        total_peak = total;
+    }
+
+    // Add another (concurrent) account's peaks and holdings to this one.
+    void merge(MemoryAccount const& other) {
+        for(int c = 0; c < categories; ++c) {
+            current[c] += other.current[c];
+            peak[c] += other.peak[c];
+        }
+        total += other.total;
+        total_peak += other.total_peak;
+    }
+
+    // Peak bytes, in total and by category, and per vertex of a `vertex_count` run.
+    void report(std::ostream& os, size_t vertex_count) const {
+        os << "peak " << total_peak << " bytes";
+        if(vertex_count)
+            os << ", " << std::fixed << std::setprecision(1) << double(total_peak) / vertex_count
+               << " per vertex" << std::defaultfloat;
+        os << " (";
+        for(int c = 0; c < categories; ++c)
+            os << (c ? ", " : "") << category_names[c] << " " << peak[c];
+        os << ")\n";
+    }
+};
+
+// Books its bytes to `account` (if any) under category C; memory comes from `resource`,
+// or from std::allocator when that is null.
+template<typename T, MemoryAccount::Category C>
+struct CountingAllocator {
+    using value_type = T;
+    template<typename U>
+    struct rebind {
+        using other = CountingAllocator<U, C>;
+    };
+
+    MemoryAccount* account = nullptr;
+    std::pmr::memory_resource* resource = nullptr;
+
+    // Moved or swapped containers take their nodes' allocator along, so the nodes stay
+    // booked to (and are freed into) the account and resource they came from.
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    CountingAllocator() = default;
+    explicit CountingAllocator(MemoryAccount* a, std::pmr::memory_resource* r = nullptr) : account(a), resource(r) {}
+    template<typename U>
+    CountingAllocator(CountingAllocator<U, C> const& other) : account(other.account), resource(other.resource) {}
+
+    T* allocate(size_t n) {
+        if(account)
+            account->allocate(C, n * sizeof(T));
+        if(resource)
+            return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        if(account)
+            account->deallocate(C, n * sizeof(T));
+        if(resource)
+            resource->deallocate(p, n * sizeof(T), alignof(T));
+        else
+            std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(CountingAllocator<U, C> const& other) const {
+        return account == other.account && resource == other.resource;
+    }
+    template<typename U>
+    bool operator!=(CountingAllocator<U, C> const& other) const { return !(*this == other); }
+};
+#endif
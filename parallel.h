@@ -0,0 +1,114 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+/****************************************************************************************
+ * Small persistent thread pool for batches of independent polygons.
+ *
+ * parallel_for(count, f) calls f(worker, i) for every i < count and returns when all
+ * calls are done. `worker` is in [0, size()) and is stable for the duration of one
+ * call of f, so callers can keep per worker scratch (e.g. one EarClipper per worker).
+ * The calling thread takes part as worker 0. Calls from several threads take turns
+ * (f must not call parallel_for on the same pool). If f throws, the remaining indices
+ * are skipped and the first exception is rethrown on the calling thread.
+ **/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    std::vector<std::thread> threads;
+    std::mutex batch;                   // held for a whole parallel_for
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::function<void(unsigned)> job;  // runs one worker's share of the batch
+    uint64_t generation = 0;
+    unsigned busy = 0;
+    bool stopping = false;
+
+    void worker_loop(unsigned worker) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+            lock.unlock();
+            job(worker);
+            lock.lock();
+            if(--busy == 0)
+                done.notify_one();
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned size = std::max(1u, std::thread::hardware_concurrency())) {
+        for(unsigned worker = 1; worker < size; ++worker)
+            threads.emplace_back([this, worker] { worker_loop(worker); });
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(auto& t : threads)
+            t.join();
+    }
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    unsigned size() const { return threads.size() + 1; }
+
+    template<typename F>
+    void parallel_for(size_t count, F&& f) {
+        if(count == 0)
+            return;
+        std::atomic<size_t> next_index{0};
+        std::exception_ptr failure;
+        std::mutex failure_mutex;
+        auto run = [&](unsigned worker) {
+            try {
+                for(size_t i; (i = next_index.fetch_add(1, std::memory_order_relaxed)) < count; )
+                    f(worker, i);
+            } catch(...) {
+                next_index.store(count, std::memory_order_relaxed);    // skip the rest
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if(!failure)
+                    failure = std::current_exception();
+            }
+        };
+        if(threads.empty() || count == 1) {
+            for(size_t i = 0; i < count; ++i)
+                f(0, i);
+            return;
+        }
+        std::lock_guard<std::mutex> turn(batch);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = run;
+            busy = threads.size();
+            ++generation;
+        }
+        wake.notify_all();
+        run(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return busy == 0; });
+            job = nullptr;
+        }
+        if(failure)
+            std::rethrow_exception(failure);
+    }
+};
+#endif
@@ -0,0 +1,165 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+/****************************************************************************************
+ * Hardware performance counters per phase of a run (earclipper --perf-counters):
+ * cycles, instructions, L1 data read misses, last level cache misses and branch misses
+ * from perf_event_open, plus wall time, for load, integrate_polygon,
+ * find_concave_and_eartips, the clipping loop and output.
+ *
+ * PhaseProfile is handed to EarClipper::set_phase_hooks() for the phases inside reset()
+ * and brackets the others itself. Totals are kept per polygon size bucket (powers of 4)
+ * and reported per point, so buckets compare directly. Counters the kernel refuses
+ * (perf_event_paranoid, virtual machines) read as unavailable; wall time always works.
+ * Multiplexed counters are scaled by their enabled / running time.
+ **/
+
+#include "earclipper.h"
+#include "size_bucket.h"
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+class PhaseProfile final : public PhaseHooks {
+public:
+    static constexpr int events = 5;
+    static constexpr char const* event_names[events] = {"cycles", "instr", "L1d_miss", "LLC_miss", "br_miss"};
+
+private:
+    struct Sample {
+        uint64_t count[events] = {};
+        uint64_t ns = 0;
+    };
+    struct Totals {
+        size_t polygons = 0, points = 0;
+        std::array<Sample, phases> phase;
+    };
+
+    int fds[events];
+    int open_error = 0;                 // errno of the first counter that failed to open
+    std::array<Sample, phases> current; // the polygon being profiled
+    Phase running = phases;
+    Sample started;
+    std::map<size_t, Totals> buckets;   // by smallest size in the bucket
+
+    // cumulative values now, scaled for multiplexing
+    Sample now() const {
+        Sample s;
+        for(int e = 0; e < events; ++e) {
+            uint64_t value[3];          // value, time enabled, time running
+            if(fds[e] < 0 || ::read(fds[e], value, sizeof value) != sizeof value || value[2] == 0)
+                continue;
+            s.count[e] = value[2] == value[1] ? value[0] : uint64_t(double(value[0]) * value[1] / value[2]);
+        }
+        s.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        return s;
+    }
+
+    static int open_counter(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+public:
+    PhaseProfile() {
+        constexpr uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        std::pair<uint32_t, uint64_t> const config[events] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, l1d_read_miss},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for(int e = 0; e < events; ++e) {
+            fds[e] = open_counter(config[e].first, config[e].second);
+            if(fds[e] < 0 && open_error == 0)
+                open_error = errno;
+        }
+    }
+    ~PhaseProfile() {
+        for(int fd : fds)
+            if(fd >= 0)
+                ::close(fd);
+    }
+    PhaseProfile(PhaseProfile const&) = delete;
+    PhaseProfile& operator=(PhaseProfile const&) = delete;
+
+    bool available(int event) const { return fds[event] >= 0; }
+    // Why a counter is unavailable: strerror of the first failed perf_event_open.
+    char const* unavailable_reason() const { return open_error ? std::strerror(open_error) : ""; }
+
+    void begin(Phase phase) override {
+        running = phase;
+        started = now();
+    }
+    void end() override {
+        auto stopped = now();
+        auto& s = current[running];
+        for(int e = 0; e < events; ++e)
+            s.count[e] += stopped.count[e] - started.count[e];
+        s.ns += stopped.ns - started.ns;
+        running = phases;
+    }
+
+    // Book the phases since the last call to the bucket of a polygon of `points` points.
+    void finish_polygon(size_t points) {
+        auto& totals = buckets[SizeBucket::of(points)];
+        ++totals.polygons;
+        totals.points += points;
+        for(int p = 0; p < phases; ++p) {
+            for(int e = 0; e < events; ++e)
+                totals.phase[p].count[e] += current[p].count[e];
+            totals.phase[p].ns += current[p].ns;
+        }
+        current = {};
+    }
+
+    // Per bucket and phase: wall time, then each counter per point and IPC.
+    void report(std::ostream& os) const {
+        static constexpr char const* phase_names[phases] = {"load", "integrate", "find_eartips", "clip", "output"};
+        if(open_error)
+            os << "some counters unavailable (" << unavailable_reason() << "), shown as -\n";
+        for(auto const& [lower, totals] : buckets) {
+            os << "points " << SizeBucket::range(lower) << ": "
+               << totals.polygons << " polygons, " << totals.points << " points\n";
+            os << std::setw(14) << "phase" << std::setw(10) << "ms";
+            for(auto name : event_names)
+                os << std::setw(11) << name;
+            os << std::setw(7) << "IPC" << "   (counts per point)\n";
+            for(int p = 0; p < phases; ++p) {
+                auto const& s = totals.phase[p];
+                os << std::setw(14) << phase_names[p] << std::setw(10) << std::fixed << std::setprecision(3) << s.ns / 1e6;
+                for(int e = 0; e < events; ++e) {
+                    if(available(e))
+                        os << std::setw(11) << std::setprecision(2) << double(s.count[e]) / totals.points;
+                    else
+                        os << std::setw(11) << "-";
+                }
+                if(available(0) && available(1) && s.count[0])
+                    os << std::setw(7) << std::setprecision(2) << double(s.count[1]) / s.count[0];
+                else
+                    os << std::setw(7) << "-";
+                os << "\n";
+            }
+            os << std::defaultfloat;
+        }
+    }
+};
+#endif
@@ -0,0 +1,180 @@
+#ifndef POINT_LOCATION_H
+#define POINT_LOCATION_H
+/****************************************************************************************
+ * Point location over a triangulation, for many point-in-polygon queries against one
+ * outline (DRC): a uniform grid over the triangles' bounding box with, per cell, the
+ * triangles overlapping it.
+ *
+ * The grid has about as many cells as triangles, so a query tests a handful of
+ * triangles instead of every edge of the ring. Cell lists hold 32 bit triangle numbers
+ * only, the corners are kept once per triangle (structure of arrays). Batched queries
+ * are sorted by cell so that each triangle of a cell is tested against all of its
+ * queries in one branch free loop the compiler can vectorise. Triangles are closed:
+ * points on an edge are inside.
+ **/
+
+#include "la2d.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+class TriangleGrid {
+    Point origin;                   // lower left of the grid
+    Num cell_w = 1, cell_h = 1;
+    uint32_t nx = 0, ny = 0;
+    std::vector<uint32_t> cell_start;       // nx * ny + 1 offsets into cell_triangles
+    std::vector<int32_t> cell_triangles;    // triangle numbers, cell after cell
+    std::vector<Num> ax, ay, bx, by, cx, cy;    // counter clockwise corners, rebased
+
+    // cell of p, or -1 outside the grid
+    int64_t cell_of(Point const& p) const {
+        auto x = p.x - origin.x, y = p.y - origin.y;
+        if(x < 0 || y < 0)
+            return -1;
+        auto i = int64_t(x / cell_w), j = int64_t(y / cell_h);
+        if(i >= nx || j >= ny)
+            return -1;
+        return j * nx + i;
+    }
+
+    // x extent of the triangle within the strip ylo <= y <= yhi: the ends of its edges
+    // clipped to the strip (false if it misses the strip)
+    static bool strip_extent(Point const* t, Num ylo, Num yhi, double& xl, double& xr) {
+        xl = HUGE_VAL, xr = -HUGE_VAL;
+        for(int e = 0; e < 3; ++e) {
+            auto a = t[e], b = t[(e + 1) % 3];
+            if(a.y > b.y)
+                std::swap(a, b);
+            if(b.y < ylo || a.y > yhi)
+                continue;
+            for(auto y : {std::max(a.y, ylo), std::min(b.y, yhi)}) {
+                double x = a.y == b.y ? double(y == a.y ? a.x : b.x)
+                                      : a.x + double(y - a.y) * double(b.x - a.x) / double(b.y - a.y);
+                xl = std::min(xl, x), xr = std::max(xr, x);
+            }
+            if(a.y == b.y)
+                xl = std::min(xl, double(std::min(a.x, b.x))), xr = std::max(xr, double(std::max(a.x, b.x)));
+        }
+        return xl <= xr;
+    }
+
+    bool inside(size_t k, Num x, Num y) const {
+        return ((bx[k] - ax[k]) * (y - ay[k]) - (by[k] - ay[k]) * (x - ax[k]) >= 0) &
+               ((cx[k] - bx[k]) * (y - by[k]) - (cy[k] - by[k]) * (x - bx[k]) >= 0) &
+               ((ax[k] - cx[k]) * (y - cy[k]) - (ay[k] - cy[k]) * (x - cx[k]) >= 0);
+    }
+
+public:
+    // Index the triangles given as 3 indices each into `points`.
+    void build(Point const* points, uint32_t const* indices, size_t index_count) {
+        size_t count = index_count / 3;
+        cell_start.assign(1, 0);
+        cell_triangles.clear();
+        for(auto* v : {&ax, &ay, &bx, &by, &cx, &cy})
+            v->assign(count, 0);
+        nx = ny = 0;
+        if(count == 0)
+            return;
+
+        Point lo = points[indices[0]], hi = lo;
+        for(size_t i = 0; i < index_count; ++i) {
+            auto const& p = points[indices[i]];
+            lo = {std::min(lo.x, p.x), std::min(lo.y, p.y)};
+            hi = {std::max(hi.x, p.x), std::max(hi.y, p.y)};
+        }
+        origin = lo;
+        double w = double(hi.x - lo.x) + 1, h = double(hi.y - lo.y) + 1;
+        nx = std::max<uint32_t>(1, uint32_t(std::sqrt(count * w / h)));
+        ny = std::max<uint32_t>(1, uint32_t(count / nx));
+        nx = uint32_t(std::min<double>(nx, w));
+        ny = uint32_t(std::min<double>(ny, h));
+        cell_w = Num(std::ceil(w / nx));
+        cell_h = Num(std::ceil(h / ny));
+
+        // two passes over the overlapped cells: count, then fill
+        std::vector<uint32_t> fill(nx * ny + 1, 0);
+        auto visit = [&](auto&& f) {
+            for(size_t t = 0; t < count; ++t) {
+                Point tri[3] = {points[indices[3 * t]], points[indices[3 * t + 1]], points[indices[3 * t + 2]]};
+                if(triangle_area(tri[0], tri[1], tri[2]) < 0)
+                    std::swap(tri[1], tri[2]);
+                ax[t] = tri[0].x - origin.x, ay[t] = tri[0].y - origin.y;
+                bx[t] = tri[1].x - origin.x, by[t] = tri[1].y - origin.y;
+                cx[t] = tri[2].x - origin.x, cy[t] = tri[2].y - origin.y;
+                auto box = bounding_box(tri[0], tri[1], tri[2]);
+                auto j0 = int64_t((box.ymin - origin.y) / cell_h), j1 = int64_t((box.ymax - origin.y) / cell_h);
+                for(auto j = j0; j <= j1; ++j) {
+                    // cells of row j the triangle reaches into, with half a unit to spare
+                    double xl, xr;
+                    Num ylo = origin.y + j * cell_h;
+                    if(!strip_extent(tri, ylo, ylo + cell_h, xl, xr))
+                        continue;
+                    auto i0 = std::max<int64_t>(0, int64_t(std::floor((xl - 0.5 - origin.x) / cell_w)));
+                    auto i1 = std::min<int64_t>(nx - 1, int64_t(std::floor((xr + 0.5 - origin.x) / cell_w)));
+                    for(auto i = i0; i <= i1; ++i)
+                        f(size_t(j * nx + i), t);
+                }
+            }
+        };
+        visit([&](size_t cell, size_t) { ++fill[cell + 1]; });
+        for(size_t c = 0; c < nx * ny; ++c)
+            fill[c + 1] += fill[c];
+        cell_start = fill;
+        cell_triangles.resize(fill.back());
+        visit([&](size_t cell, size_t t) { cell_triangles[fill[cell]++] = int32_t(t); });
+    }
+
+    size_t entries() const { return cell_triangles.size(); }
+
+    // Number of a triangle containing p, -1 if none does.
+    int32_t locate(Point const& p) const {
+        auto cell = cell_of(p);
+        if(cell < 0)
+            return -1;
+        Num x = p.x - origin.x, y = p.y - origin.y;
+        int32_t hit = -1;
+        for(auto k = cell_start[cell]; k != cell_start[cell + 1]; ++k) {
+            auto t = cell_triangles[k];
+            hit = inside(t, x, y) ? t : hit;
+        }
+        return hit;
+    }
+    bool contains(Point const& p) const {
+        return locate(p) >= 0;
+    }
+
+    // locate() for a batch: queries are grouped by cell, then every triangle of a cell
+    // is tested against all of the cell's queries.
+    void locate(Point const* queries, size_t count, int32_t* out) const {
+        std::vector<uint32_t> start(nx * ny + 2, 0), order(count);
+        std::vector<int64_t> cells(count);
+        for(size_t q = 0; q < count; ++q) {
+            cells[q] = cell_of(queries[q]);
+            ++start[cells[q] + 2];      // outside (-1) counts in slot 1
+        }
+        for(size_t c = 1; c < start.size(); ++c)
+            start[c] += start[c - 1];
+        for(size_t q = 0; q < count; ++q)
+            order[start[cells[q] + 1]++] = q;
+
+        std::vector<Num> x(count), y(count);
+        std::vector<int32_t> hit(count, -1);
+        for(size_t k = 0; k < count; ++k) {
+            x[k] = queries[order[k]].x - origin.x;
+            y[k] = queries[order[k]].y - origin.y;
+        }
+        // start[c] now ends cell c - 1; cell c's queries are [start[c], start[c + 1])
+        for(size_t cell = 0; cell < size_t(nx) * ny; ++cell) {
+            auto q0 = start[cell], q1 = start[cell + 1];
+            for(auto k = cell_start[cell]; k != cell_start[cell + 1] && q0 != q1; ++k) {
+                auto t = cell_triangles[k];
+                for(auto q = q0; q < q1; ++q)
+                    hit[q] = inside(t, x[q], y[q]) ? t : hit[q];
+            }
+        }
+        for(size_t k = 0; k < count; ++k)
+            out[order[k]] = hit[k];
+    }
+};
+#endif
@@ -0,0 +1,119 @@
+#ifndef REFLEX_KDTREE_H
+#define REFLEX_KDTREE_H
+/****************************************************************************************
+ * Static k-d tree over the reflex points of one polygon, with deletion by live counts.
+ *
+ * The tree is implicit in the order of the caller's array: build() reorders the items
+ * so that the range [lo, hi) is split by the item at its midpoint (x at even depths,
+ * y at odd ones), down to leaf ranges of at most `leaf_size` items. Per range the tree
+ * keeps the split value, the range's extent along the split axis and the number of
+ * live items; erase() decrements the counts on the path to a slot, and query() skips
+ * ranges with nothing left or outside the box, so queries stay O(log n + k) however
+ * the points are distributed, rows of equal coordinates included.
+ **/
+
+#include "la2d.h"
+#include "memory_accounting.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class ReflexKdTree {
+    struct Node {
+        Num split = 0;
+        Num low = 0, high = 0;      // extent of the range along the split axis
+        uint32_t live = 0;
+    };
+    std::vector<Node, CountingAllocator<Node, MemoryAccount::reflex_index>> nodes;  // by the midpoint slot of each range
+    uint32_t count = 0;
+    uint32_t leaf = 8;
+
+    struct Range {
+        uint32_t lo, hi, depth;
+    };
+
+    template<typename Item, typename GetPoint>
+    void build(Item* items, uint32_t lo, uint32_t hi, uint32_t depth, GetPoint& point) {
+        if(lo == hi)
+            return;
+        auto mid = lo + (hi - lo) / 2;
+        nodes[mid].live = hi - lo;
+        if(hi - lo <= leaf)
+            return;
+        bool by_y = depth & 1;
+        std::nth_element(items + lo, items + mid, items + hi, [&](Item const& u, Item const& v) {
+            return by_y ? point(u).y < point(v).y : point(u).x < point(v).x;
+        });
+        nodes[mid].split = by_y ? point(items[mid]).y : point(items[mid]).x;
+        auto [low, high] = std::minmax_element(items + lo, items + hi, [&](Item const& u, Item const& v) {
+            return by_y ? point(u).y < point(v).y : point(u).x < point(v).x;
+        });
+        nodes[mid].low = by_y ? point(*low).y : point(*low).x;
+        nodes[mid].high = by_y ? point(*high).y : point(*high).x;
+        build(items, lo, mid, depth + 1, point);
+        build(items, mid + 1, hi, depth + 1, point);
+    }
+
+public:
+    // Nodes are booked to `account`, if any, and allocated from `resource`, if any.
+    explicit ReflexKdTree(MemoryAccount* account = nullptr, std::pmr::memory_resource* resource = nullptr)
+        : nodes(decltype(nodes)::allocator_type(account, resource)) {}
+
+    // Reorder items (a vector) into k-d order; point(item) gives the coordinates the tree
+    // splits on.
+    template<typename Items, typename GetPoint>
+    void build(Items& items, GetPoint point, uint32_t leaf_size = 8) {
+        count = items.size();
+        leaf = std::max<uint32_t>(1, leaf_size);
+        nodes.assign(count, Node{});
+        build(items.data(), 0, count, 0, point);
+    }
+
+    void erase(uint32_t slot) {
+        uint32_t lo = 0, hi = count;
+        while(lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            --nodes[mid].live;
+            if(slot == mid || hi - lo <= leaf)
+                return;
+            if(slot < mid)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+    }
+
+    // Call visit(first, last) for slot ranges that may hold live items inside `box`;
+    // stops and returns false as soon as visit returns false.
+    template<typename Visit>
+    bool query(Box const& box, Visit&& visit) const {
+        Range stack[2 * 64];
+        size_t top = 0;
+        if(count)
+            stack[top++] = {0, count, 0};
+        while(top) {
+            auto [lo, hi, depth] = stack[--top];
+            auto mid = lo + (hi - lo) / 2;
+            if(nodes[mid].live == 0)
+                continue;
+            if(hi - lo <= leaf) {
+                if(!visit(lo, hi))
+                    return false;
+                continue;
+            }
+            bool by_y = depth & 1;
+            auto box_low = by_y ? box.ymin : box.xmin, box_high = by_y ? box.ymax : box.xmax;
+            if(box_high < nodes[mid].low || box_low > nodes[mid].high)
+                continue;
+            if(!visit(mid, mid + 1))
+                return false;
+            auto split = nodes[mid].split;
+            if(box_low <= split && lo < mid)
+                stack[top++] = {lo, mid, depth + 1};
+            if(box_high >= split && mid + 1 < hi)
+                stack[top++] = {mid + 1, hi, depth + 1};
+        }
+        return true;
+    }
+};
+#endif
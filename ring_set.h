@@ -0,0 +1,266 @@
+#ifndef RING_SET_H
+#define RING_SET_H
+/****************************************************************************************
+ * Triangulation of an unordered set of rings under the even-odd rule: outlines, holes,
+ * islands inside holes and so on, given in any orientation.
+ *
+ * ring_parents() builds the containment hierarchy with one left to right sweep: at each
+ * ring's leftmost vertex the edge directly above it either bounds a ring it is inside
+ * (that ring is the parent) or belongs to a sibling (same parent). Rings at even depth
+ * are filled; each is made counter clockwise, its direct children clockwise, and the
+ * children are bridged into it (as in square_disk.csv) before ear clipping. Components
+ * are triangulated in parallel.
+ *
+ * Rings must be simple and must not touch each other. Triangle indices refer to the
+ * input points as if all rings were concatenated in order.
+ **/
+
+#include "earclipper.h"
+#include "parallel.h"
+#include "sweep_line.h"
+#include <set>
+#include <vector>
+
+using Ring = std::vector<Point>;
+
+struct RingSetComponent {
+    uint32_t outer = 0;             // ring number of the filled outline
+    std::vector<uint32_t> holes;    // ring numbers of its direct holes
+    std::vector<uint32_t> indices;  // 3 per triangle, into the concatenated rings
+    bool complete = false;          // triangle areas add up to the component area
+};
+
+namespace ring_set {
+
+// number of points without a repeated closing point
+inline size_t open_size(Ring const& ring) {
+    auto n = ring.size();
+    if(n > 1 && ring[0].x == ring[n-1].x && ring[0].y == ring[n-1].y)
+        --n;
+    return n;
+}
+
+// Orientation test used when splicing holes, in long double as the ray hit is not on
+// the fixed point grid.
+inline long double orient(long double ax, long double ay, long double bx, long double by,
+                          long double cx, long double cy) {
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+// Is `m` inside the angle the ring makes at merged[i] (counter clockwise ring)?
+inline bool locally_inside(std::vector<Vertex> const& merged, size_t i, Point const& m) {
+    auto n = merged.size();
+    auto const& a = merged[(i + n - 1) % n];
+    auto const& p = merged[i];
+    auto const& b = merged[(i + 1) % n];
+    if(triangle_area(a, p, b) >= 0)
+        return triangle_area(a, p, m) >= 0 && triangle_area(p, b, m) >= 0;
+    return triangle_area(a, p, m) >= 0 || triangle_area(p, b, m) >= 0;
+}
+
+// Splice a clockwise hole into the counter clockwise `merged` ring through a bridge
+// from the hole's rightmost point to a visible vertex on the right. False if no edge
+// of `merged` is hit (the hole is not inside).
+inline bool bridge_hole(std::vector<Vertex>& merged, std::vector<Vertex> const& hole) {
+    size_t h = 0;
+    for(size_t i = 1; i < hole.size(); ++i) {
+        if(hole[i].x > hole[h].x || (hole[i].x == hole[h].x && hole[i].y > hole[h].y))
+            h = i;
+    }
+    auto const m = hole[h];
+    auto n = merged.size();
+
+    // nearest upward edge hit by the ray to +x: the ring is left of it
+    long double hit_x = 0;
+    size_t bridge = n;
+    for(size_t i = 0; i < n; ++i) {
+        auto const& p = merged[i];
+        auto const& q = merged[(i + 1) % n];
+        if(p.y <= m.y && m.y <= q.y && p.y != q.y) {
+            long double x = p.x + (long double)(m.y - p.y) * (q.x - p.x) / (q.y - p.y);
+            if(x >= m.x && (bridge == n || x < hit_x)) {
+                hit_x = x;
+                bridge = q.x > p.x ? (i + 1) % n : i;
+            }
+        }
+    }
+    if(bridge == n)
+        return false;
+
+    // a vertex inside the triangle (m, hit, bridge) would block the bridge: take the one
+    // closest in angle to the ray instead
+    if(hit_x != merged[bridge].x || m.y != merged[bridge].y) {
+        auto const b = merged[bridge];
+        long double tan_min = -1;
+        bool above = b.y > m.y;
+        for(size_t i = 0; i < n; ++i) {
+            auto const& p = merged[i];
+            if(p.x < m.x || p.x > b.x || p.x == m.x)
+                continue;
+            long double d1 = orient(m.x, m.y, hit_x, m.y, p.x, p.y);
+            long double d2 = orient(hit_x, m.y, b.x, b.y, p.x, p.y);
+            long double d3 = orient(b.x, b.y, m.x, m.y, p.x, p.y);
+            bool inside = above ? (d1 >= 0 && d2 >= 0 && d3 >= 0) : (d1 <= 0 && d2 <= 0 && d3 <= 0);
+            if(!inside || !locally_inside(merged, i, m))
+                continue;
+            long double tan = (long double)(p.y > m.y ? p.y - m.y : m.y - p.y) / (p.x - m.x);
+            if(tan_min < 0 || tan < tan_min || (tan == tan_min && p.x > merged[bridge].x)) {
+                tan_min = tan;
+                bridge = i;
+            }
+        }
+    }
+
+    std::vector<Vertex> spliced;
+    spliced.reserve(hole.size() + 2);
+    for(size_t k = 0; k <= hole.size(); ++k)
+        spliced.push_back(hole[(h + k) % hole.size()]);
+    spliced.push_back(merged[bridge]);
+    merged.insert(merged.begin() + bridge + 1, spliced.begin(), spliced.end());
+    return true;
+}
+
+} // namespace ring_set
+
+// Parent ring of every ring in the even-odd containment hierarchy, -1 at the top level
+// (and for rings with fewer than 3 points).
+inline std::vector<int32_t> ring_parents(std::vector<Ring> const& rings) {
+    enum Kind { remove, insert, query };
+    struct Event {
+        Num x;
+        Kind kind;
+        uint32_t item;          // edge for remove/insert, ring for query
+    };
+    std::vector<SweepEdge> edges;
+    std::vector<Event> events;
+    std::vector<Point> leftmost(rings.size());
+    std::vector<bool> ccw(rings.size());
+    for(uint32_t r = 0; r < rings.size(); ++r) {
+        auto const& ring = rings[r];
+        auto n = ring_set::open_size(ring);
+        if(n < 3)
+            continue;
+        ccw[r] = integrate_polygon(ring) > 0;
+        leftmost[r] = ring[0];
+        for(size_t i = 0; i < n; ++i) {
+            auto const& p = ring[i];
+            if(p.x < leftmost[r].x || (p.x == leftmost[r].x && p.y < leftmost[r].y))
+                leftmost[r] = p;
+            auto e = SweepEdge::make(p, ring[(i + 1) % n], edges.size(), r);
+            if(e.vertical())
+                continue;
+            events.push_back({e.a.x, insert, uint32_t(edges.size())});
+            events.push_back({e.b.x, remove, uint32_t(edges.size())});
+            edges.push_back(e);
+        }
+        events.push_back({leftmost[r].x, query, r});
+    }
+    // edges are active on [a.x, b.x): at equal x remove, then insert, then query
+    std::sort(events.begin(), events.end(), [](Event const& u, Event const& v) {
+        return u.x != v.x ? u.x < v.x : u.kind < v.kind;
+    });
+
+    Point sweep{0, 0};
+    std::set<SweepEdge, SweepOrder> active(SweepOrder{&sweep});
+    std::vector<std::set<SweepEdge, SweepOrder>::iterator> handles(edges.size());
+    std::vector<int32_t> parent(rings.size(), -1), sibling(rings.size(), -1);
+    for(auto const& e : events) {
+        // the whole event point, not just x: edges leaving one vertex must tie there
+        if(e.kind == remove)
+            active.erase(handles[e.item]);
+        else if(e.kind == insert) {
+            sweep = edges[e.item].a;
+            handles[e.item] = active.insert(edges[e.item]).first;
+        }
+        else {
+            sweep = leftmost[e.item];
+            auto above = active.upper_bound(leftmost[e.item]);
+            while(above != active.end() && above->ring == e.item)
+                ++above;
+            if(above == active.end())
+                continue;
+            // a counter clockwise ring runs right to left along its top side
+            if(above->reversed == ccw[above->ring])
+                parent[e.item] = above->ring;
+            else
+                sibling[e.item] = above->ring;
+        }
+    }
+
+    // siblings share the parent of the ring whose edge was found
+    for(size_t r = 0; r < rings.size(); ++r) {
+        std::vector<size_t> chain;
+        auto s = r;
+        while(parent[s] < 0 && sibling[s] >= 0 && chain.size() <= rings.size()) {
+            chain.push_back(s);
+            s = sibling[s];
+        }
+        for(auto c : chain) {
+            parent[c] = parent[s];
+            sibling[c] = -1;
+        }
+    }
+    return parent;
+}
+
+// Triangulate each filled ring with its direct holes, components in parallel.
+inline std::vector<RingSetComponent> triangulate_rings(std::vector<Ring> const& rings,
+                                                       ThreadPool& pool = ThreadPool::instance()) {
+    auto parent = ring_parents(rings);
+    std::vector<uint32_t> depth(rings.size(), 0), offset(rings.size() + 1, 0);
+    std::vector<int32_t> component_of(rings.size(), -1);
+    std::vector<RingSetComponent> components;
+    for(size_t r = 0; r < rings.size(); ++r) {
+        offset[r + 1] = offset[r] + rings[r].size();
+        for(auto p = parent[r]; p >= 0; p = parent[p])
+            ++depth[r];
+    }
+    for(uint32_t r = 0; r < rings.size(); ++r) {
+        if(depth[r] % 2 == 0 && ring_set::open_size(rings[r]) >= 3) {
+            component_of[r] = components.size();
+            components.emplace_back().outer = r;
+        }
+    }
+    for(uint32_t r = 0; r < rings.size(); ++r) {
+        if(depth[r] % 2 == 1 && ring_set::open_size(rings[r]) >= 3 && component_of[parent[r]] >= 0)
+            components[component_of[parent[r]]].holes.push_back(r);
+    }
+
+    auto load = [&](uint32_t r, bool want_ccw) {
+        auto const& ring = rings[r];
+        std::vector<Vertex> vertices(ring_set::open_size(ring));
+        for(size_t i = 0; i < vertices.size(); ++i) {
+            static_cast<Point&>(vertices[i]) = ring[i];
+            vertices[i].index = offset[r] + i;
+        }
+        if((integrate_polygon(ring) > 0) != want_ccw)
+            std::reverse(vertices.begin(), vertices.end());
+        return vertices;
+    };
+
+    std::vector<EarClipper> clippers(pool.size());
+    pool.parallel_for(components.size(), [&](unsigned worker, size_t c) {
+        auto& component = components[c];
+        auto merged = load(component.outer, true);
+        std::vector<std::vector<Vertex>> holes;
+        for(auto h : component.holes)
+            holes.push_back(load(h, false));
+        // rightmost holes first, so later bridges may end on earlier holes
+        auto right = [](std::vector<Vertex> const& hole) {
+            return std::max_element(hole.begin(), hole.end(), [](Vertex const& u, Vertex const& v) { return u.x < v.x; })->x;
+        };
+        std::sort(holes.begin(), holes.end(), [&](auto const& u, auto const& v) { return right(u) > right(v); });
+        bool bridged = true;
+        for(auto const& hole : holes)
+            bridged &= ring_set::bridge_hole(merged, hole);
+
+        auto& clipper = clippers[worker];
+        clipper.reset(merged.begin(), merged.end());
+        clipper.clip([&](Vertex const& p0, Vertex const& p1, Vertex const& p2) {
+            component.indices.insert(component.indices.end(), {p0.index, p1.index, p2.index});
+        });
+        component.complete = bridged && clipper.area_matches();
+    });
+    return components;
+}
+#endif
@@ -0,0 +1,109 @@
+#ifndef SELF_INTERSECTION_H
+#define SELF_INTERSECTION_H
+/****************************************************************************************
+ * O(n log n) simplicity check of a polygon ring (Shamos-Hoey), as a gate in front of the
+ * clipper for untrusted input.
+ *
+ * One sweep over the vertices keeps the edges under the sweep line in y order and only
+ * tests edges that become neighbours there; the first contact between edges that are
+ * not consecutive on the ring, or consecutive edges folding back onto each other, stops
+ * it. Rings with holes bridged in by coincident edges (square_disk.csv) are not simple
+ * in this sense.
+ **/
+
+#include "la2d.h"
+#include "sweep_line.h"
+#include <algorithm>
+#include <set>
+#include <vector>
+
+struct SelfIntersection {
+    bool found = false;
+    size_t first = 0, second = 0;   // edges, numbered by the input position of their start
+};
+
+template<typename Iterator>
+SelfIntersection find_self_intersection(Iterator first, Iterator last) {
+    // drop repeated points (and the closing one), remembering input positions
+    std::vector<Point> ring;
+    std::vector<size_t> position;
+    for(size_t i = 0; first != last; ++first, ++i) {
+        Point const& p = *first;
+        if(ring.empty() || p != ring.back()) {
+            ring.push_back(p);
+            position.push_back(i);
+        }
+    }
+    while(ring.size() > 1 && ring.back() == ring.front()) {
+        ring.pop_back();
+        position.pop_back();
+    }
+    SelfIntersection result;
+    uint32_t n = ring.size();
+    if(n < 3)
+        return result;
+
+    std::vector<SweepEdge> edges(n);
+    for(uint32_t i = 0; i < n; ++i)
+        edges[i] = SweepEdge::make(ring[i], ring[(i + 1) % n], i);
+    auto consecutive = [n](uint32_t u, uint32_t v) {
+        return (u + 1) % n == v || (v + 1) % n == u;
+    };
+    auto touch = [&](uint32_t u, uint32_t v) {
+        if(!consecutive(u, v))
+            return segments_intersect(ring[u], ring[(u + 1) % n], ring[v], ring[(v + 1) % n]);
+        // a -> s -> b share s; anything more is a fold back
+        if((v + 1) % n == u)
+            std::swap(u, v);
+        auto const& a = ring[u], &s = ring[v], &b = ring[(v + 1) % n];
+        return on_segment(b, a, s) || on_segment(a, s, b);
+    };
+    auto report = [&](uint32_t u, uint32_t v) {
+        result = {true, std::min(position[u], position[v]), std::max(position[u], position[v])};
+    };
+
+    Point event{0, 0};
+    std::set<SweepEdge, SweepOrder> status(SweepOrder{&event});
+    std::vector<std::set<SweepEdge, SweepOrder>::iterator> handles(n);
+    std::vector<uint32_t> ends_here;    // edges with an end at the event point
+    bool passing = false;               // an edge runs through the event point
+    uint32_t passing_edge = 0;
+    sweep_events(edges,
+        [&](uint32_t e) {
+            status.erase(handles[e]);
+            ends_here.push_back(e);
+        },
+        [&](Point const& p) {
+            event = p;
+            auto [lo, hi] = status.equal_range(p);
+            passing = lo != hi;
+            if(passing)
+                passing_edge = lo->id;
+        },
+        [&](uint32_t e) {
+            handles[e] = status.insert(edges[e]).first;
+            ends_here.push_back(e);
+        },
+        [&](Point const& p) {
+            // one visit of the ring to p brings two consecutive edges
+            if(passing)
+                report(passing_edge, ends_here.front());
+            for(size_t i = 0; i < ends_here.size() && !result.found; ++i) {
+                for(size_t j = i + 1; j < ends_here.size() && !result.found; ++j) {
+                    if(!consecutive(ends_here[i], ends_here[j]))
+                        report(ends_here[i], ends_here[j]);
+                }
+            }
+            ends_here.clear();
+            // new neighbours: around and within the edges starting at p
+            auto [lo, hi] = status.equal_range(p);
+            auto it = lo == status.begin() ? lo : std::prev(lo);
+            for(; !result.found && it != hi && std::next(it) != status.end(); ++it) {
+                if(touch(it->id, std::next(it)->id))
+                    report(it->id, std::next(it)->id);
+            }
+            return !result.found;
+        });
+    return result;
+}
+#endif
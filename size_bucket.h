@@ -0,0 +1,27 @@
+#ifndef SIZE_BUCKET_H
+#define SIZE_BUCKET_H
+/****************************************************************************************
+ * Polygon size buckets for per size reports (PhaseProfile, LatencyRecorder): powers of
+ * 4 from 16 points, with everything below 16 in one bucket. A bucket is keyed by its
+ * smallest size, 0 for the first.
+ **/
+
+#include <cstddef>
+#include <string>
+
+struct SizeBucket {
+    static size_t of(size_t points) {
+        size_t lower = 16;
+        if(points < lower)
+            return 0;
+        while(points >= 4 * lower)
+            lower *= 4;
+        return lower;
+    }
+
+    // "lower..upper" sizes of the bucket keyed `lower`
+    static std::string range(size_t lower) {
+        return std::to_string(lower ? lower : 3) + ".." + std::to_string(lower ? 4 * lower - 1 : 15);
+    }
+};
+#endif
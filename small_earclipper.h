@@ -0,0 +1,155 @@
+#ifndef SMALL_EARCLIPPER_H
+#define SMALL_EARCLIPPER_H
+/****************************************************************************************
+ * Ear clipping specialised on the vertex count for small polygons (pads, 3..16 points).
+ *
+ * Links, turn areas and the reflex set live in stack arrays and a bit mask; the initial
+ * convexity pass and the containment test against reflex points are unrolled over N.
+ * triangulate_indices() dispatches on the size: small polygons take this path, larger
+ * ones (or a small one the specialised pass cannot complete) go through EarClipper.
+ **/
+
+#include "earclipper.h"
+#include "snap_rounding.h"
+#include <utility>
+
+constexpr size_t small_polygon_max = 16;
+
+struct TriangulationResult {
+    size_t size = 0;            // number of indices written (3 per triangle)
+    bool complete = false;      // triangle areas add up to the polygon area
+};
+
+namespace small_polygon {
+
+template<size_t N>
+struct Ring {
+    Point const* points;
+    uint8_t prev[N]{}, next[N]{};
+    Num turn[N]{};              // doubled signed area at each vertex
+    uint32_t reflex = 0;        // bit per vertex, fixed at start and only cleared
+    Num area_from_integral = 0;
+
+    void update_turn(size_t i) {
+        turn[i] = triangle_area(points[prev[i]], points[i], points[next[i]]);
+    }
+    bool convex(size_t i) const {
+        return turn[i] != 0 && (turn[i] > 0) == (area_from_integral > 0);
+    }
+
+    template<size_t... I>
+    void init(std::index_sequence<I...>) {
+        ((prev[I] = I == 0 ? N - 1 : I - 1, next[I] = I + 1 == N ? 0 : I + 1), ...);
+        area_from_integral = -(((points[I].y + points[next[I]].y) * (points[next[I]].x - points[I].x)) + ...);
+        (update_turn(I), ...);
+        reflex = ((uint32_t(!convex(I)) << I) | ...);
+    }
+
+    template<size_t... I>
+    bool blocked(Point const& a, Point const& b, Point const& c, std::index_sequence<I...>) const {
+        return (((reflex >> I & 1) && blocks_ear(points[I], a, b, c)) || ...);
+    }
+    bool ear(size_t i) const {
+        return convex(i) && !blocked(points[prev[i]], points[i], points[next[i]], std::make_index_sequence<N>{});
+    }
+};
+
+template<size_t N>
+TriangulationResult triangulate(Point const* points, uint32_t* out) {
+    Ring<N> ring{points};
+    ring.init(std::make_index_sequence<N>{});
+
+    TriangulationResult result;
+    Num area_from_triangulation = 0;
+    size_t first = 0;
+    for(size_t remaining = N; remaining >= 3; --remaining) {
+        // prefer a proper ear, otherwise drop a degenerate (zero area) vertex
+        size_t clip = N;
+        for(size_t i = first, k = 0; k < remaining; i = ring.next[i], ++k) {
+            if(ring.ear(i)) {
+                clip = i;
+                break;
+            }
+        }
+        if(clip == N) {
+            for(size_t i = first, k = 0; k < remaining; i = ring.next[i], ++k) {
+                if(ring.turn[i] == 0) {
+                    clip = i;
+                    break;
+                }
+            }
+        }
+        if(clip == N)
+            break;
+
+        auto p0 = ring.prev[clip], p2 = ring.next[clip];
+        if(ring.turn[clip]) {
+            area_from_triangulation += ring.turn[clip];
+            out[result.size++] = p0;
+            out[result.size++] = clip;
+            out[result.size++] = p2;
+        }
+        ring.reflex &= ~(uint32_t(1) << clip);
+        ring.next[p0] = p2;
+        ring.prev[p2] = p0;
+        first = p0;
+        for(auto p : {p0, p2}) {
+            ring.update_turn(p);
+            if(ring.convex(p))
+                ring.reflex &= ~(uint32_t(1) << p);
+        }
+    }
+    auto error = area_from_triangulation - ring.area_from_integral;
+    result.complete = (error < 0 ? -error : error) <= epsilon;
+    return result;
+}
+
+using Triangulate = TriangulationResult (*)(Point const*, uint32_t*);
+
+template<size_t... N>
+constexpr std::array<Triangulate, sizeof...(N)> make_table(std::index_sequence<N...>) {
+    return {&triangulate<N + 3>...};
+}
+inline constexpr auto table = make_table(std::make_index_sequence<small_polygon_max - 2>{});
+
+// Small polygon path by size, EarClipper otherwise.
+inline TriangulationResult dispatch(EarClipper& clipper, Point const* points, size_t n, uint32_t* out) {
+    auto m = n;
+    // if given last point = first: ignore it
+    if(m > 3 && points[0].x == points[m-1].x && points[0].y == points[m-1].y)
+        --m;
+    if(m >= 3 && m <= small_polygon_max) {
+        auto result = table[m - 3](points, out);
+        if(result.complete)
+            return result;
+    }
+
+    TriangulationResult result;
+    clipper.reset(points, points + n);
+    clipper.clip([&](Vertex const& p0, Vertex const& p1, Vertex const& p2) {
+        out[result.size++] = p0.index;
+        out[result.size++] = p1.index;
+        out[result.size++] = p2.index;
+    });
+    result.complete = clipper.area_matches();
+    return result;
+}
+
+} // namespace small_polygon
+
+// Triangulate n points into out (room for 3*(n-2) indices), picking the small polygon
+// path by size and falling back to `clipper` otherwise. Floating point input is snap
+// rounded first; the indices still refer to the input points.
+inline TriangulationResult triangulate_indices(EarClipper& clipper, Point const* points, size_t n, uint32_t* out) {
+    if constexpr(!use_fixed_point_arithmetic) {
+        auto ring = snap_round(points, points + n);
+        if(ring.points.empty())
+            return {0, true};       // collapsed to nothing
+        auto result = small_polygon::dispatch(clipper, ring.points.data(), ring.points.size(), out);
+        for(size_t k = 0; k < result.size; ++k)
+            out[k] = ring.source[out[k]];
+        return result;
+    }
+    return small_polygon::dispatch(clipper, points, n, out);
+}
+#endif
@@ -0,0 +1,123 @@
+#ifndef SNAP_ROUNDING_H
+#define SNAP_ROUNDING_H
+/****************************************************************************************
+ * Snap rounding pre-pass for floating point input: near duplicate points (closer than
+ * epsilon allows for) otherwise give needle triangles and ear decisions that flip with
+ * rounding.
+ *
+ * Every point is snapped to the nearest multiple of the grid. A hash grid of the cells
+ * claimed so far makes points that straddle a cell border, but are within one grid
+ * step of a claimed point, take that cell instead; so near duplicates become exact
+ * duplicates in O(n) expected time. Consecutive duplicates are then merged and the
+ * spikes that snapping leaves (a point where the ring turns straight back) removed.
+ * Non consecutive duplicates (the bridges of square_disk.csv) are kept.
+ **/
+
+#include "la2d.h"
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+struct SnappedRing {
+    std::vector<Point> points;
+    std::vector<uint32_t> source;   // input position of each point
+};
+
+namespace snap_rounding {
+
+template<typename T>
+int64_t cell_of(T v, T grid) {
+    if constexpr(std::is_integral_v<T>) {
+        auto shifted = v + grid / 2;
+        return shifted / grid - (shifted % grid < 0 ? 1 : 0);  // floor division
+    } else {
+        return std::llround(v / grid);
+    }
+}
+
+// Grid cell, compared whole: distinct cells may share a hash
+struct Cell {
+    int64_t x, y;
+    bool operator==(Cell const& o) const { return x == o.x && y == o.y; }
+};
+
+struct CellHash {
+    size_t operator()(Cell const& c) const {
+        return size_t(uint64_t(c.x) * 0x9e3779b97f4a7c15ull ^ uint64_t(c.y));
+    }
+};
+
+// a turns straight back at b towards a
+inline bool spike(Point const& a, Point const& b, Point const& c) {
+    auto ab = a - b, bc = b - c;
+    return triangle_area(a, b, c) == 0 && ab.x * bc.x + ab.y * bc.y < 0;
+}
+
+} // namespace snap_rounding
+
+// Snap the ring [first, last) to multiples of `grid`, merging near duplicates and
+// removing spikes. May return fewer than 3 points for a ring that collapses.
+template<typename Iterator>
+SnappedRing snap_round(Iterator first, Iterator last, Num grid = snap_grid) {
+    using namespace snap_rounding;
+    SnappedRing ring;
+    std::unordered_map<Cell, Point, CellHash> claimed;    // cell -> first raw point snapped to it
+    claimed.reserve(std::distance(first, last));
+    auto snap = [&](Point const& p) {
+        auto cx = cell_of(p.x, grid), cy = cell_of(p.y, grid);
+        if(!claimed.count(Cell{cx, cy})) {
+            bool near = false;
+            for(int64_t dy = -1; dy <= 1 && !near; ++dy)
+                for(int64_t dx = -1; dx <= 1 && !near; ++dx) {
+                    auto found = claimed.find(Cell{cx + dx, cy + dy});
+                    if(found == claimed.end())
+                        continue;
+                    auto d = p - found->second;
+                    if(double(d.x) * d.x + double(d.y) * d.y < double(grid) * grid)
+                        cx += dx, cy += dy, near = true;
+                }
+            if(!near)
+                claimed.emplace(Cell{cx, cy}, p);
+        }
+        return Point{Num(cx * grid), Num(cy * grid)};
+    };
+
+    auto& out = ring.points;
+    for(uint32_t index = 0; first != last; ++first, ++index) {
+        auto p = snap(*first);
+        if(!out.empty() && out.back() == p)
+            continue;
+        out.push_back(p);
+        ring.source.push_back(index);
+        while(out.size() >= 3 && spike(out[out.size() - 3], out[out.size() - 2], out.back())) {
+            out.erase(out.end() - 2);
+            ring.source.erase(ring.source.end() - 2);
+            if(out[out.size() - 2] == out.back())
+                out.pop_back(), ring.source.pop_back();
+        }
+    }
+    // the same across the closing edge
+    auto erase = [&](size_t k) {
+        out.erase(out.begin() + k);
+        ring.source.erase(ring.source.begin() + k);
+    };
+    for(bool changed = true; changed && out.size() >= 3; ) {
+        changed = true;
+        auto n = out.size();
+        if(out.back() == out.front())
+            erase(n - 1);
+        else if(spike(out[n - 2], out[n - 1], out[0]))
+            erase(n - 1);
+        else if(spike(out[n - 1], out[0], out[1]))
+            erase(0);
+        else
+            changed = false;
+    }
+    if(out.size() < 3)
+        out.clear(), ring.source.clear();
+    return ring;
+}
+#endif
@@ -0,0 +1,109 @@
+#ifndef STATIC_EARCLIPPER_H
+#define STATIC_EARCLIPPER_H
+/****************************************************************************************
+ * constexpr ear clipping of fixed size polygons, for footprints known at compile time:
+ *
+ *   constexpr std::array<Point, 4> pad = {{{0, 0}, {20, 0}, {20, 10}, {0, 10}}};
+ *   constexpr auto tris = static_triangulate(pad);
+ *   static_assert(tris.complete);
+ *
+ * Same rules as EarClipper (reflex points fixed at start, a reflex point inside an ear
+ * or on its cut blocks it, coincident points do not, degenerate triangles are dropped)
+ * on plain arrays with index links instead of std::list / std::unordered_set.
+ * Quadratic per ear, so meant for small N.
+ **/
+
+#include "la2d.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+template<size_t N>
+struct StaticTriangulation {
+    static_assert(N >= 3, "a polygon needs at least 3 points");
+    std::array<std::array<uint32_t, 3>, N - 2> triangles{};
+    size_t size = 0;            // number of triangles used in `triangles`
+    bool complete = false;      // triangle areas add up to the polygon area
+
+    constexpr auto begin() const { return triangles.begin(); }
+    constexpr auto end() const { return triangles.begin() + size; }
+};
+
+template<size_t N>
+constexpr StaticTriangulation<N> static_triangulate(std::array<Point, N> const& points) {
+    StaticTriangulation<N> result;
+    size_t n = N;
+    // if given last point = first: ignore it
+    if(points[0].x == points[N-1].x && points[0].y == points[N-1].y)
+        --n;
+    if(n < 3)
+        return result;
+
+    std::array<uint32_t, N> prev{}, next{};
+    std::array<bool, N> reflex{};
+    Num area_from_integral = 0, area_from_triangulation = 0;
+    for(size_t i = 0; i < n; ++i) {
+        prev[i] = i == 0 ? n - 1 : i - 1;
+        next[i] = i + 1 == n ? 0 : i + 1;
+        auto const& p0 = points[i];
+        auto const& p1 = points[next[i]];
+        area_from_integral -= (p0.y + p1.y) * (p1.x - p0.x);
+    }
+
+    auto convex = [&](size_t i) {
+        auto area = triangle_area(points[prev[i]], points[i], points[next[i]]);
+        return area != 0 && (area > 0) == (area_from_integral > 0);
+    };
+    auto ear = [&](size_t i) {
+        auto const& a = points[prev[i]];
+        auto const& b = points[i];
+        auto const& c = points[next[i]];
+        for(size_t v = 0; v < n; ++v) {
+            if(reflex[v] && blocks_ear(points[v], a, b, c))
+                return false;
+        }
+        return true;
+    };
+    for(size_t i = 0; i < n; ++i)
+        reflex[i] = !convex(i);
+
+    size_t first = 0;
+    for(size_t remaining = n; remaining >= 3; --remaining) {
+        // prefer a proper ear, otherwise drop a degenerate (zero area) vertex
+        size_t clip = n;
+        for(size_t i = first, k = 0; k < remaining; i = next[i], ++k) {
+            if(convex(i) && ear(i)) {
+                clip = i;
+                break;
+            }
+        }
+        if(clip == n) {
+            for(size_t i = first, k = 0; k < remaining; i = next[i], ++k) {
+                if(triangle_area(points[prev[i]], points[i], points[next[i]]) == 0) {
+                    clip = i;
+                    break;
+                }
+            }
+        }
+        if(clip == n)
+            break;
+
+        auto area = triangle_area(points[prev[clip]], points[clip], points[next[clip]]);
+        if(area) {
+            area_from_triangulation += area;
+            result.triangles[result.size++] = {prev[clip], uint32_t(clip), next[clip]};
+        }
+        reflex[clip] = false;
+        next[prev[clip]] = next[clip];
+        prev[next[clip]] = prev[clip];
+        first = next[clip];
+        for(auto p : {prev[clip], next[clip]}) {
+            if(convex(p))
+                reflex[p] = false;
+        }
+    }
+    auto error = area_from_triangulation - area_from_integral;
+    result.complete = (error < 0 ? -error : error) <= epsilon;
+    return result;
+}
+#endif
@@ -0,0 +1,135 @@
+#ifndef SWEEP_LINE_H
+#define SWEEP_LINE_H
+/****************************************************************************************
+ * Building blocks for left to right sweeps over polygon edges.
+ *
+ * SweepEdge stores an edge with its lower end first (by x, then y). SweepOrder orders
+ * edges by their y at the current event point (ties by slope, then id), which is a
+ * consistent order for edges that do not cross between insertion and removal. A
+ * vertical edge sits at the event's y, and above every other edge through the same
+ * point, as if the sweep line were tilted a little. Comparisons are exact in fixed
+ * point (128 bit intermediates), long double otherwise (where edges through the event
+ * point still tie exactly).
+ **/
+
+#include "la2d.h"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+struct SweepEdge {
+    Point a, b;                 // a.x < b.x, or a.x == b.x and a.y < b.y (vertical)
+    uint32_t id = 0;            // caller's edge number
+    uint32_t ring = 0;          // caller's ring number
+    bool reversed = false;      // the ring runs from b to a
+
+    static SweepEdge make(Point p, Point q, uint32_t id = 0, uint32_t ring = 0) {
+        if(q.x < p.x || (q.x == p.x && q.y < p.y))
+            return {q, p, id, ring, true};
+        return {p, q, id, ring, false};
+    }
+    bool vertical() const { return a.x == b.x; }
+};
+
+inline int sign(WideNum v) {
+    return (v > 0) - (v < 0);
+}
+
+// event order of the sweep: by x, then y
+inline bool sweep_before(Point const& p, Point const& q) {
+    return p.x < q.x || (p.x == q.x && p.y < q.y);
+}
+
+// sign of the turn a -> b -> c
+inline int orientation(Point const& a, Point const& b, Point const& c) {
+    return sign(WideNum(b.x - a.x) * (c.y - a.y) - WideNum(b.y - a.y) * (c.x - a.x));
+}
+
+// sign of (y of e at x) - y, for a.x <= x <= b.x of a non vertical edge
+inline int compare_y_at(SweepEdge const& e, Num x, Num y) {
+    WideNum dx = e.b.x - e.a.x;
+    WideNum ey = WideNum(e.a.y) * dx + WideNum(e.b.y - e.a.y) * (x - e.a.x);
+    return sign(ey - WideNum(y) * dx);
+}
+
+// sign of (y of e) - (y of f) at x, both non vertical and spanning x
+inline int compare_y_at(SweepEdge const& e, SweepEdge const& f, Num x) {
+    WideNum dxe = e.b.x - e.a.x, dxf = f.b.x - f.a.x;
+    WideNum ye = WideNum(e.a.y) * dxe + WideNum(e.b.y - e.a.y) * (x - e.a.x);
+    WideNum yf = WideNum(f.a.y) * dxf + WideNum(f.b.y - f.a.y) * (x - f.a.x);
+    return sign(ye * dxf - yf * dxe);
+}
+
+// sign of slope(e) - slope(f), vertical edges being steepest
+inline int compare_slope(SweepEdge const& e, SweepEdge const& f) {
+    if(e.vertical() || f.vertical())
+        return int(e.vertical()) - int(f.vertical());
+    return sign(WideNum(e.b.y - e.a.y) * (f.b.x - f.a.x) - WideNum(f.b.y - f.a.y) * (e.b.x - e.a.x));
+}
+
+// Strict weak order of active edges at the event point *at; also compares against a
+// query Point (a point is "less" than every edge strictly above it).
+struct SweepOrder {
+    using is_transparent = void;
+    Point const* at;
+
+    // sign of (y of e at the event) - y
+    int compare(SweepEdge const& e, Num y) const {
+        if(e.vertical())
+            return sign(WideNum(std::clamp(at->y, e.a.y, e.b.y)) - WideNum(y));
+        return compare_y_at(e, at->x, y);
+    }
+    bool operator()(SweepEdge const& e, SweepEdge const& f) const {
+        int c = 0;
+        if(e.vertical())
+            c = -compare(f, std::clamp(at->y, e.a.y, e.b.y));
+        else if(f.vertical())
+            c = compare(e, std::clamp(at->y, f.a.y, f.b.y));
+        else if constexpr(use_fixed_point_arithmetic)
+            c = compare_y_at(e, f, at->x);
+        else {
+            // against the event's y first: edges through the event point must tie, which
+            // the rounded products of compare_y_at(e, f) do not promise
+            int ce = compare(e, at->y), cf = compare(f, at->y);
+            c = ce != cf || ce == 0 ? ce - cf : compare_y_at(e, f, at->x);
+        }
+        if(c)
+            return c < 0;
+        // equal at the event: edges meet here, the flatter one is below to the right
+        if(auto c = compare_slope(e, f))
+            return c < 0;
+        return e.id < f.id;
+    }
+    bool operator()(Point const& p, SweepEdge const& e) const {
+        return compare(e, p.y) > 0;
+    }
+    bool operator()(SweepEdge const& e, Point const& p) const {
+        return compare(e, p.y) < 0;
+    }
+};
+
+// Visit the event points of `edges` in sweep order: end(i) for edges ending there, then
+// at(p), then start(i) for edges starting there, then after(p), which returns false to
+// stop the sweep.
+template<typename End, typename At, typename Start, typename After>
+void sweep_events(std::vector<SweepEdge> const& edges, End&& end, At&& at, Start&& start, After&& after) {
+    std::vector<uint32_t> starts(edges.size()), ends(edges.size());
+    for(uint32_t i = 0; i < edges.size(); ++i)
+        starts[i] = ends[i] = i;
+    std::sort(starts.begin(), starts.end(), [&](uint32_t u, uint32_t v) { return sweep_before(edges[u].a, edges[v].a); });
+    std::sort(ends.begin(), ends.end(), [&](uint32_t u, uint32_t v) { return sweep_before(edges[u].b, edges[v].b); });
+    size_t s = 0, e = 0;
+    while(s < starts.size() || e < ends.size()) {
+        Point p = s == starts.size() ? edges[ends[e]].b : e == ends.size() ? edges[starts[s]].a
+                : sweep_before(edges[ends[e]].b, edges[starts[s]].a) ? edges[ends[e]].b : edges[starts[s]].a;
+        for(; e < ends.size() && edges[ends[e]].b == p; ++e)
+            end(ends[e]);
+        at(p);
+        for(; s < starts.size() && edges[starts[s]].a == p; ++s)
+            start(starts[s]);
+        if(!after(p))
+            return;
+    }
+}
+#endif
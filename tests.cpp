@@ -0,0 +1,577 @@
+/****************************************************************************************
+ * Tests:  tests [section]
+ *
+ *   ears       EarClipper never cuts through a reflex point on an ear's diagonal, and
+ *              clips through repeated points
+ *   generator  EarClipper::triangles() yields what clip() emits, and stopping early
+ *              frees the coroutine and leaves the clipper reusable
+ *   move       a move-assigned clipper takes the other's memory and account, and clips on
+ *   small      the size-specialised path completes the footprints below on its own
+ *   moments    polygon_moments of rectangles either side of the 2^31 exact sum limit
+ *   weld       triangulate_welded joins squares at negative and signed zero coordinates
+ *   rings      ring_parents and triangulate_rings on nested holes and islands, given in
+ *              mixed orientations
+ *   winding    tessellate and winding_boundary cover the even-odd and non-zero areas of
+ *              two overlapping squares and of a pentagram
+ *   intersect  find_self_intersection names the crossing edges of a ring with two
+ *              vertices swapped, counting repeated points; pinches and fold backs count
+ *              as contact, a comb passes
+ *   locate     TriangleGrid finds points inside a comb's triangles and on its edges, none
+ *              between its teeth or off the grid, batched as one by one
+ *   coverage   CoverageRaster gives the exact area fractions of a square one cell wide
+ *              lying across four cells, for either triangle orientation and band height
+ *   capi       ec_triangulate answers a capacity query, refuses too small a buffer
+ *              without writing to it, then fills one (fixed point build)
+ *   server     triangulation_service answers pipelined requests in a sealed memfd over a
+ *              socketpair: triangles, the capacity needed, a bad request
+ *   snap       snap_round merges a near duplicate whose cell shares a hash with another
+ *              (floating point build)
+ *
+ * static_triangulate is checked by static_asserts, so those fail the build instead.
+ * The fixed point build links earclipper_c.cpp; the floating point build leaves it out,
+ * as the C interface is fixed point only.
+ *
+ * Exit status is the number of failed checks.
+ **/
+#include "coverage_raster.h"
+#include "earclipper_c.h"
+#include "earclipper.h"
+#include "mesh_welding.h"
+#include "point_location.h"
+#include "polygon_moments.h"
+#include "ring_set.h"
+#include "self_intersection.h"
+#include "small_earclipper.h"
+#include "static_earclipper.h"
+#include "triangulation_server.h"
+#include "winding_tessellation.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+// Live bytes from global operator new, to check coroutine frames are freed.
+static std::atomic<long> live_bytes{0};
+
+// Out of line: inlined into library code, the header offset reads to GCC as freeing a
+// pointer operator new returned (-Wmismatched-new-delete, -Warray-bounds).
+[[gnu::noinline]] void* operator new(size_t size) {
+    auto header = static_cast<size_t*>(std::malloc(size + 16));
+    if(!header)
+        throw std::bad_alloc();
+    *header = size;
+    live_bytes += size;
+    return reinterpret_cast<char*>(header) + 16;
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    if(!p)
+        return;
+    auto header = reinterpret_cast<size_t*>(static_cast<char*>(p) - 16);
+    live_bytes -= *header;
+    std::free(header);
+}
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+// Footprints clipped at compile time: a rectangle pad, an L pad whose only ear cuts
+// pass by the reflex corner, and a square ring stitched to its hole by a bridge.
+constexpr std::array<Point, 4> rectangle_pad = {{{0, 0}, {20, 0}, {20, 10}, {0, 10}}};
+static_assert(static_triangulate(rectangle_pad).complete);
+static_assert(static_triangulate(rectangle_pad).size == 2);
+
+constexpr std::array<Point, 6> l_pad = {{{0, 0}, {20, 0}, {20, 10}, {10, 10}, {10, 20}, {0, 20}}};
+static_assert(static_triangulate(l_pad).complete);
+static_assert(static_triangulate(l_pad).size == 4);
+
+constexpr std::array<Point, 10> stitched_ring = {{
+    {0, 0}, {30, 0}, {30, 30}, {0, 30}, {0, 0},         // outer, counterclockwise
+    {10, 10}, {10, 20}, {20, 20}, {20, 10}, {10, 10}}}; // hole, clockwise
+static_assert(static_triangulate(stitched_ring).complete);
+static_assert(static_triangulate(stitched_ring).size == 8);
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, char const* what) {
+    if(!ok) {
+        std::cout << "FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+// Comb of `teeth` teeth: many reflex points, so ear order matters.
+std::vector<Point> comb(size_t teeth) {
+    std::vector<Point> points{{0, 0}, {Num(10 * teeth), 0}};
+    for(size_t t = teeth; t-- > 0; ) {
+        Num x = 10 * t;
+        points.push_back({x + 10, 2});
+        points.push_back({x + 6, 50});
+        points.push_back({x + 4, 50});
+        points.push_back({x + 1, 2});
+    }
+    return points;
+}
+
+std::vector<Triangle> clip_all(EarClipper& clipper) {
+    std::vector<Triangle> triangles;
+    clipper.clip([&](Vertex const& p0, Vertex const& p1, Vertex const& p2) { triangles.push_back({p0, p1, p2}); });
+    return triangles;
+}
+
+bool same(std::vector<Triangle> const& a, std::vector<Triangle> const& b) {
+    if(a.size() != b.size())
+        return false;
+    for(size_t t = 0; t < a.size(); ++t)
+        for(int k = 0; k < 3; ++k)
+            if(a[t][k].index != b[t][k].index || !(a[t][k] == b[t][k]))
+                return false;
+    return true;
+}
+
+// Is any of the points strictly inside one of the triangles?
+bool covers_point(std::vector<Triangle> const& triangles, std::vector<Point> const& points) {
+    for(auto const& t : triangles)
+        for(auto const& v : points)
+            if(inside_triangle(v, t[0], t[1], t[2]))
+                return true;
+    return false;
+}
+
+// Every triangle counterclockwise, as the polygons below are: a reflex "ear" clipped by
+// mistake comes out clockwise, and the areas can still add up.
+bool counterclockwise(std::vector<Triangle> const& triangles) {
+    for(auto const& t : triangles)
+        if(triangle_area(t[0], t[1], t[2]) <= 0)
+            return false;
+    return true;
+}
+
+// Points left collinear are clipped as degenerate ears and emit nothing, so a vertex may
+// end up on a triangle's edge; only interiors and orientation are checked.
+void test_ears() {
+    // The L pad's ear at (0, 0) would cut from (0, 20) to (20, 0), through the reflex
+    // corner (10, 10). A comb has rows of reflex points on such cuts.
+    std::vector<Point> l(l_pad.begin(), l_pad.end());
+    for(auto index : {EarClipper::ReflexIndex::scan, EarClipper::ReflexIndex::sorted_x, EarClipper::ReflexIndex::kd_tree}) {
+        for(auto const& polygon : {l, comb(6)}) {
+            EarClipper clipper;
+            clipper.set_reflex_index(index);
+            clipper.reset(polygon.begin(), polygon.end());
+            auto triangles = clip_all(clipper);
+            check(clipper.area_matches() && counterclockwise(triangles) && !covers_point(triangles, polygon),
+                  "ears: no cut through a reflex point on the diagonal");
+        }
+    }
+
+    // every point of a comb twice, and the ring closed: one of each run is kept
+    auto polygon = comb(16);
+    std::vector<Point> repeated;
+    for(auto const& p : polygon)
+        repeated.insert(repeated.end(), {p, p});
+    repeated.push_back(polygon.front());
+    EarClipper clipper;
+    clipper.reset(repeated.begin(), repeated.end());
+    auto triangles = clip_all(clipper);
+    check(clipper.area_matches() && counterclockwise(triangles) && !covers_point(triangles, polygon),
+          "ears: clips through repeated points");
+}
+
+#if __cpp_impl_coroutine >= 201902L
+void test_generator() {
+    auto polygon = comb(16);
+    // Ear order follows node addresses: replaying the same allocations from the same
+    // buffer gives both clippers identical state.
+    static char buffer[1 << 20];
+    std::pmr::monotonic_buffer_resource memory(buffer, sizeof buffer, std::pmr::null_memory_resource());
+    std::vector<Triangle> clipped, yielded;
+    {
+        EarClipper clipper(&memory);
+        clipper.reset(polygon.begin(), polygon.end());
+        clipped = clip_all(clipper);
+        check(clipper.area_matches(), "generator: clip() covers the polygon");
+    }
+    memory.release();
+    {
+        EarClipper clipper(&memory);
+        clipper.reset(polygon.begin(), polygon.end());
+        for(auto const& t : clipper.triangles())
+            yielded.push_back(t);
+        check(clipper.area_matches(), "generator: triangles() covers the polygon");
+    }
+    check(!clipped.empty(), "generator: clip() emits triangles");
+    check(same(clipped, yielded), "generator: triangles() yields clip()'s triangles in order");
+
+    // stop after a few triangles: the frame goes, the clipper clips the next polygon
+    EarClipper clipper;
+    clipper.reset(polygon.begin(), polygon.end());
+    auto before = live_bytes.load() - long(clipper.memory().total);
+    {
+        size_t taken = 0;
+        for(auto const& t : clipper.triangles()) {
+            (void)t;
+            if(++taken == 3)
+                break;
+        }
+    }
+    auto after = live_bytes.load() - long(clipper.memory().total);
+    check(after == before, "generator: breaking out frees the coroutine frame");
+    clipper.reset(polygon.begin(), polygon.end());
+    auto rest = clip_all(clipper);
+    check(!rest.empty() && clipper.area_matches(), "generator: clipper reusable after break");
+}
+#else
+void test_generator() {}
+#endif
+
+void test_move() {
+    auto big = comb(16), small = comb(3);
+    auto before = live_bytes.load();
+    {
+        static char buffer[1 << 16];
+        std::pmr::monotonic_buffer_resource memory(buffer, sizeof buffer, std::pmr::null_memory_resource());
+        EarClipper target, source(&memory);
+        target.reset(big.begin(), big.end());
+        source.reset(small.begin(), small.end());
+        auto held = source.memory().total;
+        target = std::move(source);     // target's own nodes go back to its old account
+        check(target.memory().total == held && target.memory_resource() == &memory,
+              "move: nodes stay booked to the account and resource they came from");
+        clip_all(target);
+        check(target.area_matches(), "move: clips the moved-in polygon");
+        target.reset(small.begin(), small.end());
+        clip_all(target);
+        check(target.area_matches(), "move: clips after reset");
+    }
+    check(live_bytes.load() == before, "move: nothing leaks");
+}
+
+void test_small() {
+    uint32_t out[3 * 8];
+    check(small_polygon::triangulate<4>(rectangle_pad.data(), out).complete, "small: rectangle pad");
+    check(small_polygon::triangulate<6>(l_pad.data(), out).complete, "small: L pad");
+    check(small_polygon::triangulate<10>(stitched_ring.data(), out).complete, "small: stitched ring");
+}
+
+bool near(long double value, long double expected) {
+    return std::fabs(value - expected) <= 1e-15L * std::fabs(expected);
+}
+
+void test_moments() {
+    auto rectangle = [](Num x, Num y, Num w, Num h) {
+        return std::vector<Point>{{x, y}, {x + w, y}, {x + w, y + h}, {x, y + h}};
+    };
+    auto check_rectangle = [](std::vector<Point> const& r, bool exact, char const* what) {
+        long double x = r[0].x, y = r[0].y, w = r[1].x - x, h = r[2].y - y;
+        auto m = polygon_moments(r);
+        bool ok = near(m.area(), w * h) && near(m.centroid_x(), x + w / 2) && near(m.centroid_y(), y + h / 2) &&
+                  near(m.central_xx(), w * w * w * h / 12) && near(m.central_yy(), w * h * h * h / 12) &&
+                  std::fabs(m.central_xy()) <= 1e-15L * w * w * h * h;
+        check(ok && (m.exact == exact || !use_fixed_point_arithmetic), what);
+    };
+    constexpr Num limit = Num(int64_t(1) << 31);
+    check_rectangle(rectangle(-5, 7, limit - 1, limit - 1), true, "moments: exact just below 2^31");
+    check_rectangle(rectangle(-5, 7, limit, 3), false, "moments: long double from 2^31");
+    check_rectangle(rectangle(-limit * 1000, limit, limit * 2000, limit * 512), false, "moments: far wider");
+}
+
+void test_weld() {
+    Num zero = -Num(0);     // -0.0 in the floating point build
+    std::vector<std::vector<Point>> squares = {
+        {{-10, -10}, {0, -10}, {0, 0}, {-10, 0}},
+        {{zero, -10}, {10, -10}, {10, zero}, {zero, zero}},
+    };
+    auto mesh = triangulate_welded(squares);
+    check(mesh.complete && mesh.vertices.size() == 6, "weld: shared edge at zero becomes one");
+}
+
+// Doubled area of the triangles, indices into the concatenated rings.
+template<typename Rings>
+WideNum triangles_area2(Rings const& rings, std::vector<uint32_t> const& indices) {
+    std::vector<Point> points;
+    for(auto const& ring : rings)
+        points.insert(points.end(), ring.begin(), ring.end());
+    WideNum area2 = 0;
+    for(size_t t = 0; t + 2 < indices.size(); t += 3) {
+        auto const& a = points[indices[t]], &b = points[indices[t+1]], &c = points[indices[t+2]];
+        area2 += WideNum(b.x - a.x) * (c.y - a.y) - WideNum(b.y - a.y) * (c.x - a.x);
+    }
+    return area2;
+}
+
+void test_rings() {
+    auto square = [](Num x0, Num y0, Num x1, Num y1, bool ccw) {
+        return ccw ? Ring{{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}} : Ring{{x0, y0}, {x0, y1}, {x1, y1}, {x1, y0}};
+    };
+    std::vector<Ring> rings = {
+        square(0, 0, 100, 100, true),       // outline
+        square(10, 10, 60, 90, true),       // hole in 0
+        square(20, 20, 50, 80, false),      // island in 1
+        square(30, 30, 40, 40, true),       // hole in 2
+        square(70, 10, 90, 90, false),      // second hole in 0
+        square(200, 0, 210, 10, false),     // separate outline
+    };
+    rings[2].push_back(rings[2][0]);        // a closing point adds nothing
+    check(ring_parents(rings) == std::vector<int32_t>{-1, 0, 1, 2, 0, -1}, "rings: parent of each ring");
+
+    auto components = triangulate_rings(rings);
+    std::vector<uint32_t> indices;
+    bool complete = components.size() == 3;
+    for(auto const& c : components) {
+        complete &= c.complete;
+        indices.insert(indices.end(), c.indices.begin(), c.indices.end());
+    }
+    check(complete, "rings: three filled components, each complete");
+    // 100^2 - 50*80 - 20*80 + 30*60 - 10^2 + 10^2, counter clockwise
+    check(triangles_area2(rings, indices) == 2 * WideNum(6200), "rings: filled area under even-odd");
+}
+
+// Doubled area enclosed by the rings (holes clockwise, so they subtract).
+long double rings_area2(std::vector<Ring> const& rings) {
+    long double area2 = 0;
+    for(auto const& ring : rings)
+        for(size_t i = 0, n = ring.size(); i < n; ++i)
+            area2 += (long double)ring[i].x * ring[(i + 1) % n].y - (long double)ring[(i + 1) % n].x * ring[i].y;
+    return area2;
+}
+
+void test_winding() {
+    auto check_area = [](std::vector<Ring> const& rings, WindingRule rule, long double area, char const* what) {
+        auto t = tessellate(rings, rule);
+        std::vector<uint32_t> indices;
+        for(auto const& c : t.components)
+            indices.insert(indices.end(), c.indices.begin(), c.indices.end());
+        auto close = [&](long double area2) { return std::fabs(area2 / 2 - area) <= 1e-6L * area; };
+        check(t.complete && close(rings_area2(t.rings)) && close((long double)triangles_area2(t.rings, indices)), what);
+    };
+
+    // 20 x 20 squares overlapping in a 10 x 15 rectangle
+    std::vector<Ring> squares = {{{0, 0}, {20, 0}, {20, 20}, {0, 20}}, {{10, 5}, {30, 5}, {30, 25}, {10, 25}}};
+    check_area(squares, WindingRule::even_odd, 500, "winding: overlapping squares, even-odd");
+    check_area(squares, WindingRule::non_zero, 650, "winding: overlapping squares, non-zero");
+
+    // Pentagram: the centre pentagon winds twice. Crossings are rounded to the grid, so
+    // the areas are compared to one part in a million.
+    constexpr long double radius = 1e8;
+    long double x[5], y[5], px[5], py[5];
+    Ring pentagram;
+    for(int k = 0; k < 5; ++k) {
+        auto a = M_PI / 2 + 2 * M_PI * k / 5;
+        x[k] = std::round(radius * std::cos(a)), y[k] = std::round(radius * std::sin(a));
+    }
+    for(int k = 0; k < 5; ++k)
+        pentagram.push_back({Num(x[2 * k % 5]), Num(y[2 * k % 5])});
+    // inner corner k, between tips k and k + 1: chords k -> k + 2 and k + 1 -> k + 4 cross
+    for(int k = 0; k < 5; ++k) {
+        int a = k, b = (k + 2) % 5, c = (k + 1) % 5, d = (k + 4) % 5;
+        auto t = ((x[c] - x[a]) * (y[d] - y[c]) - (y[c] - y[a]) * (x[d] - x[c])) /
+                 ((x[b] - x[a]) * (y[d] - y[c]) - (y[b] - y[a]) * (x[d] - x[c]));
+        px[k] = x[a] + t * (x[b] - x[a]), py[k] = y[a] + t * (y[b] - y[a]);
+    }
+    long double pentagon = 0, star = 0;
+    for(int k = 0; k < 5; ++k) {
+        int j = (k + 1) % 5;
+        pentagon += (px[k] * py[j] - px[j] * py[k]) / 2;
+        star += (x[k] * py[k] - px[k] * y[k] + px[k] * y[j] - x[j] * py[k]) / 2;
+    }
+    check_area({pentagram}, WindingRule::non_zero, star, "winding: pentagram, non-zero");
+    check_area({pentagram}, WindingRule::even_odd, star - pentagon, "winding: pentagram, even-odd");
+}
+
+void test_intersect() {
+    auto find = [](std::vector<Point> const& ring) { return find_self_intersection(ring.begin(), ring.end()); };
+
+    // 64-gon with vertices 40 and 41 swapped: edges 39 and 41 cross, the edge between
+    // them touches both at its ends. A repeated first point and a closing point shift
+    // input positions by one and add no edges.
+    std::vector<Point> circle;
+    for(int k = 0; k < 64; ++k) {
+        auto a = 2 * M_PI * k / 64;
+        circle.push_back({Num(std::round(1e6 * std::cos(a))), Num(std::round(1e6 * std::sin(a)))});
+    }
+    check(!find(circle).found, "intersect: convex ring is simple");
+    std::swap(circle[40], circle[41]);
+    auto hit = find(circle);
+    check(hit.found && hit.first == 39 && hit.second == 41, "intersect: swapped vertices cross");
+    circle.insert(circle.begin(), circle[0]);
+    circle.push_back(circle[0]);
+    hit = find(circle);
+    check(hit.found && hit.first == 40 && hit.second == 42, "intersect: positions count repeated points");
+
+    // pinched at (10, 10), which edges 0, 1 and 3, 4 share
+    hit = find({{0, 0}, {10, 10}, {20, 0}, {20, 20}, {10, 10}, {0, 20}});
+    check(hit.found && hit.first <= 1 && hit.second >= 3 && hit.second <= 4, "intersect: pinch");
+    hit = find({{0, 0}, {10, 0}, {5, 0}, {5, 5}});
+    check(hit.found && hit.first == 0 && hit.second == 1, "intersect: fold back");
+    check(!find(comb(16)).found, "intersect: comb is simple");
+}
+
+void test_locate() {
+    auto teeth = comb(8);
+    std::vector<uint32_t> indices(3 * (teeth.size() - 2));
+    EarClipper clipper;
+    auto result = triangulate_indices(clipper, teeth.data(), teeth.size(), indices.data());
+    indices.resize(result.size);
+    TriangleGrid grid;
+    grid.build(teeth.data(), indices.data(), indices.size());
+
+    // triangles are closed: edges and corners are inside
+    std::vector<Point> inside = {{15, 20}, {35, 0}, {15, 50}, {0, 0}, {80, 2}, {10, 1}};
+    std::vector<Point> outside = {{20, 30}, {50, 49}, {-5, 1}, {35, -1}, {100, 100}};
+    bool ok = result.complete;
+    for(auto const& p : inside) {
+        auto t = grid.locate(p);
+        ok &= t >= 0 && triangle_area(teeth[indices[3*t]], teeth[indices[3*t+1]], p) >= 0 &&
+              triangle_area(teeth[indices[3*t+1]], teeth[indices[3*t+2]], p) >= 0 &&
+              triangle_area(teeth[indices[3*t+2]], teeth[indices[3*t]], p) >= 0;
+    }
+    check(ok, "locate: inside, on edges and on corners");
+    ok = true;
+    for(auto const& p : outside)
+        ok &= !grid.contains(p);
+    check(ok, "locate: between teeth and off the grid");
+
+    auto queries = inside;
+    queries.insert(queries.end(), outside.begin(), outside.end());
+    std::vector<int32_t> batch(queries.size());
+    grid.locate(queries.data(), queries.size(), batch.data());
+    ok = true;
+    for(size_t q = 0; q < queries.size(); ++q)
+        ok &= batch[q] == grid.locate(queries[q]);
+    check(ok, "locate: batched as one by one");
+}
+
+void test_coverage() {
+    // cells of 100 units; the square spans (50, 25) to (150, 125)
+    constexpr Num cell = 100;
+    std::vector<Point> square = {{50, 25}, {150, 25}, {150, 125}, {50, 125}};
+    double const expected[3][3] = {     // [j][i]
+        {0.375, 0.375, 0},
+        {0.125, 0.125, 0},
+        {0, 0, 0},
+    };
+    auto covers = [&](std::vector<uint32_t> const& indices, uint32_t band_rows) {
+        CoverageRaster raster({0, 0}, cell, 3, 3);
+        raster.add_triangles(square.data(), indices.data(), indices.size(), ThreadPool::instance(), band_rows);
+        bool ok = true;
+        for(uint32_t j = 0; j < 3; ++j)
+            for(uint32_t i = 0; i < 3; ++i)
+                ok &= std::fabs(raster(i, j) - expected[j][i]) <= 1e-12;
+        return ok;
+    };
+    check(covers({0, 1, 2, 0, 2, 3}, 16), "coverage: square across four cells");
+    check(covers({0, 2, 1, 0, 3, 2}, 16), "coverage: clockwise triangles");
+    check(covers({0, 1, 2, 0, 2, 3}, 1), "coverage: one row per band");
+}
+
+void test_capi() {
+    // only referenced from a discarded statement in the floating point build, so that
+    // build links without earclipper_c.cpp
+    if constexpr(use_fixed_point_arithmetic) {
+        std::vector<int64_t> xy;
+        for(auto const& p : l_pad)
+            xy.insert(xy.end(), {int64_t(p.x), int64_t(p.y)});
+        auto ctx = ec_context_create();
+        size_t len = 0;
+        check(ec_triangulate(ctx, xy.data(), 6, nullptr, 0, &len) == EC_ERR_CAPACITY && len == 12,
+              "capi: capacity query");
+        std::vector<uint32_t> out(12, UINT32_MAX);
+        check(ec_triangulate(ctx, xy.data(), 6, out.data(), 11, &len) == EC_ERR_CAPACITY && len == 12 &&
+              out == std::vector<uint32_t>(12, UINT32_MAX), "capi: too small a buffer is left alone");
+        bool ok = ec_triangulate(ctx, xy.data(), 6, out.data(), out.size(), &len) == EC_OK && len == 12;
+        out.resize(len);
+        std::vector<std::vector<Point>> rings = {{l_pad.begin(), l_pad.end()}};
+        check(ok && triangles_area2(rings, out) == 2 * WideNum(300), "capi: L pad");
+        check(ec_triangulate(ctx, xy.data(), 2, out.data(), out.size(), &len) == EC_ERR_INVALID &&
+              ec_triangulate(nullptr, xy.data(), 6, out.data(), out.size(), &len) == EC_ERR_INVALID,
+              "capi: invalid arguments");
+        ec_context_destroy(ctx);
+    }
+}
+
+void test_server() {
+    using namespace triangulation_service;
+    int ends[2];
+    if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, ends) < 0) {
+        check(false, "server: socketpair");
+        return;
+    }
+    static volatile std::sig_atomic_t stop = 0;
+    Server server;
+    server.adopt(ends[0]);
+    std::thread serving([&] { server.run(stop); });
+    {
+        Client client(ends[1], 4096);
+        check(client.connected(), "server: hello with a sealed memfd");
+        std::memcpy(client.data(), l_pad.data(), sizeof l_pad);
+        constexpr uint64_t at = 1024;      // indices
+        Reply triangles, overflow, bad;
+        bool sent = client.submit({0, 6, at, 12}) && client.submit({0, 6, at, 11}) && client.submit({0, 2, at, 12});
+        bool received = sent && client.receive(triangles) && client.receive(overflow) && client.receive(bad);
+        std::vector<uint32_t> indices(triangles.count);
+        if(received && triangles.count <= 12)
+            std::memcpy(indices.data(), client.data() + at, indices.size() * sizeof(uint32_t));
+        std::vector<std::vector<Point>> rings = {{l_pad.begin(), l_pad.end()}};
+        check(received && triangles.status == ok && triangles.count == 12 &&
+              triangles_area2(rings, indices) == 2 * WideNum(300), "server: triangles of the L pad");
+        check(received && overflow.status == triangulation_service::overflow && overflow.count == 12,
+              "server: capacity needed");
+        check(received && bad.status == bad_request, "server: too few points");
+    }   // the client hangs up, the server's last connection closes and run() returns
+    serving.join();
+    auto served = server.latency().histogram(6);
+    check(served && served->count() == 1, "server: latency of the one request served");
+}
+
+void test_snap() {
+    // Cells (4, 0) and (17715, 520784420376955) of grid 10 used to share a key, so b's cell
+    // never counted as claimed and c, 6 units from b, took a cell of its own. Cells that
+    // collide lie too far apart for fixed point triangle areas: floating point only.
+    if constexpr(!use_fixed_point_arithmetic) {
+        constexpr Num far = Num(5207844203769550);
+        std::vector<Point> ring = {{40, 0}, {177150, far}, {177156, far}, {177150, far + 10000}};
+        auto snapped = snap_round(ring.begin(), ring.end(), Num(10));
+        check(snapped.points.size() == 3 && snapped.points[1] == ring[1], "snap: near duplicate merged despite hash collision");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    auto run = [&](char const* section) { return argc < 2 || std::strcmp(argv[1], section) == 0; };
+    if(run("ears"))
+        test_ears();
+    if(run("generator"))
+        test_generator();
+    if(run("move"))
+        test_move();
+    if(run("small"))
+        test_small();
+    if(run("moments"))
+        test_moments();
+    if(run("weld"))
+        test_weld();
+    if(run("rings"))
+        test_rings();
+    if(run("winding"))
+        test_winding();
+    if(run("intersect"))
+        test_intersect();
+    if(run("locate"))
+        test_locate();
+    if(run("coverage"))
+        test_coverage();
+    if(run("capi"))
+        test_capi();
+    if(run("server"))
+        test_server();
+    if(run("snap"))
+        test_snap();
+    std::cout << (failures ? "" : "all passed\n");
+    return failures;
+}
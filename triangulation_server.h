@@ -0,0 +1,404 @@
+#ifndef TRIANGULATION_SERVER_H
+#define TRIANGULATION_SERVER_H
+/****************************************************************************************
+ * Long running triangulation service over a Unix domain socket.
+ *
+ * A client creates a memfd, sizes it, seals its size (F_SEAL_SHRINK | F_SEAL_GROW, so
+ * the server's mapping can never lose its backing and fault), connects and sends a Hello
+ * carrying the memfd (SCM_RIGHTS). The server refuses memfds that are unsealed or smaller
+ * than the Hello claims. The memfd is then used as a ring of request slots managed by the
+ * client: each Request names the byte offset of `count` Points (native layout, i.e.
+ * fixed point int64 x,y pairs) and of an index buffer with room for `capacity` uint32
+ * indices. The server triangulates with a warm EarClipper and answers with a Reply
+ * holding the number of indices written (3 per triangle), or the required capacity
+ * when the buffer is too small. Requests on one connection are answered in order, so
+ * clients may pipeline several slots before reading replies. Each request's latency is
+ * recorded (latency_histogram.h), slow polygons optionally written out as CSV.
+ *
+ * The server is one thread polling non-blocking sockets: partial Hellos and Requests
+ * are buffered per connection, and replies a client does not read yet are queued while
+ * its requests are left unread, so no client can stall the others.
+ * A Server made without a path serves connected sockets handed to it instead (one end
+ * of a socketpair), until the last one closes.
+ **/
+
+#include "latency_histogram.h"
+#include "small_earclipper.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace triangulation_service {
+
+constexpr uint32_t magic = 0x45434c50; // "ECLP"
+constexpr uint32_t version = 1;
+
+struct Hello {
+    uint32_t magic = triangulation_service::magic;
+    uint32_t version = triangulation_service::version;
+    uint64_t size = 0;              // bytes of the shared memfd
+};
+
+struct Request {
+    uint64_t points_offset = 0;     // byte offset of Point[count]
+    uint64_t count = 0;
+    uint64_t indices_offset = 0;    // byte offset of uint32_t[capacity]
+    uint64_t capacity = 0;
+};
+
+enum Status : int64_t {
+    ok = 0,
+    bad_request = -1,               // offsets out of range or fewer than 3 points
+    overflow = -2,                  // Reply::count holds the required capacity
+};
+
+struct Reply {
+    int64_t status = ok;
+    uint64_t count = 0;
+};
+
+inline bool write_all(int fd, void const* data, size_t size) {
+    auto bytes = static_cast<char const*>(data);
+    while(size) {
+        auto n = ::write(fd, bytes, size);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+inline bool read_all(int fd, void* data, size_t size) {
+    auto bytes = static_cast<char*>(data);
+    while(size) {
+        auto n = ::read(fd, bytes, size);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+inline sockaddr_un socket_address(char const* path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+// Socket connected to the server at `path`, -1 if there is none.
+inline int connect_to(char const* path) {
+    auto addr = socket_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/****************************************************************************************
+ * Server side
+ */
+class Server {
+    struct Connection {
+        int fd = -1;
+        char* region = nullptr;     // mapped memfd, null until Hello arrived
+        uint64_t size = 0;
+        int memfd = -1;             // received with a Hello still incomplete
+        alignas(Request) char partial[sizeof(Request)];    // a Hello or Request so far
+        size_t have = 0;
+        std::vector<char> output;   // replies not written yet
+    };
+    static_assert(sizeof(Hello) <= sizeof(Request));
+
+    int listener = -1;
+    std::vector<Connection> connections;
+    EarClipper clipper;             // scratch state stays warm across requests
+    LatencyRecorder recorder;
+
+    static bool would_block() {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    bool in_region(Connection const& c, uint64_t offset, uint64_t bytes, size_t align) const {
+        return offset % align == 0 && offset <= c.size && bytes <= c.size - offset;
+    }
+
+    // Read what there is of the Hello; map the memfd once it is complete.
+    bool receive_hello(Connection& c) {
+        iovec iov{c.partial + c.have, sizeof(Hello) - c.have};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        auto n = ::recvmsg(c.fd, &msg, MSG_CMSG_CLOEXEC);
+        if(n < 0)
+            return would_block();
+        if(n == 0 || (msg.msg_flags & MSG_CTRUNC))
+            return false;
+        for(auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+                continue;
+            if(c.memfd >= 0)
+                return false;       // one memfd per connection
+            std::memcpy(&c.memfd, CMSG_DATA(cmsg), sizeof(c.memfd));
+        }
+        c.have += n;
+        if(c.have < sizeof(Hello))
+            return true;
+        c.have = 0;
+        Hello hello;
+        std::memcpy(&hello, c.partial, sizeof(hello));
+        int memfd = c.memfd;
+        c.memfd = -1;
+        if(memfd < 0)
+            return false;
+        struct stat st;
+        int seals = ::fcntl(memfd, F_GET_SEALS);
+        constexpr int size_seals = F_SEAL_SHRINK | F_SEAL_GROW;
+        if(hello.magic != magic || hello.version != version || hello.size == 0
+        || ::fstat(memfd, &st) < 0 || uint64_t(st.st_size) < hello.size
+        || seals < 0 || (seals & size_seals) != size_seals) {
+            ::close(memfd);
+            return false;
+        }
+        auto region = ::mmap(nullptr, hello.size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        ::close(memfd);
+        if(region == MAP_FAILED)
+            return false;
+        c.region = static_cast<char*>(region);
+        c.size = hello.size;
+        return true;
+    }
+
+    Reply serve(Connection const& c, Request const& req) {
+        if(req.count < 3 || req.count > UINT32_MAX
+        || req.count > c.size / sizeof(Point)
+        || !in_region(c, req.points_offset, req.count * sizeof(Point), alignof(Point))
+        || req.capacity > c.size / sizeof(uint32_t)
+        || !in_region(c, req.indices_offset, req.capacity * sizeof(uint32_t), alignof(uint32_t)))
+            return {bad_request, 0};
+
+        uint64_t required = 3 * (req.count - 2);
+        if(req.capacity < required)
+            return {overflow, required};
+
+        auto points = reinterpret_cast<Point const*>(c.region + req.points_offset);
+        auto indices = reinterpret_cast<uint32_t*>(c.region + req.indices_offset);
+        auto result = recorder.time(points, req.count, [&] { return triangulate_indices(clipper, points, req.count, indices); });
+        return {ok, result.size};
+    }
+
+    // Write queued replies until the socket is full.
+    bool flush(Connection& c) {
+        size_t written = 0;
+        while(written < c.output.size()) {
+            auto n = ::send(c.fd, c.output.data() + written, c.output.size() - written, MSG_NOSIGNAL);
+            if(n < 0) {
+                if(!would_block())
+                    return false;
+                break;
+            }
+            written += n;
+        }
+        c.output.erase(c.output.begin(), c.output.begin() + written);
+        return true;
+    }
+
+    // Serve the complete Requests there are, until the socket is drained or replies back
+    // up (the client is not reading them).
+    bool receive_requests(Connection& c) {
+        while(c.output.empty()) {
+            auto n = ::read(c.fd, c.partial + c.have, sizeof(Request) - c.have);
+            if(n < 0)
+                return would_block();
+            if(n == 0)
+                return false;
+            c.have += n;
+            if(c.have < sizeof(Request))
+                continue;
+            c.have = 0;
+            Request req;
+            std::memcpy(&req, c.partial, sizeof(req));
+            auto reply = serve(c, req);
+            auto bytes = reinterpret_cast<char const*>(&reply);
+            c.output.insert(c.output.end(), bytes, bytes + sizeof(reply));
+            if(!flush(c))
+                return false;
+        }
+        return true;
+    }
+
+    // false once the connection should be dropped
+    bool handle(Connection& c, short events) {
+        if(events & (POLLERR | POLLNVAL))
+            return false;
+        if((events & POLLOUT) && !flush(c))
+            return false;
+        if(events & POLLIN)
+            return c.region ? receive_requests(c) : receive_hello(c);
+        return !(events & POLLHUP);
+    }
+
+    void drop(Connection& c) {
+        if(c.region)
+            ::munmap(c.region, c.size);
+        if(c.memfd >= 0)
+            ::close(c.memfd);
+        ::close(c.fd);
+    }
+
+public:
+    // Without a listening socket: serves the connections handed to adopt().
+    explicit Server(LatencyRecorder::Options latency = {}) : recorder(std::move(latency)) {}
+    explicit Server(char const* path, LatencyRecorder::Options latency = {}) : recorder(std::move(latency)) {
+        ::unlink(path);
+        auto addr = socket_address(path);
+        listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(listener < 0
+        || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+        || ::listen(listener, SOMAXCONN) < 0) {
+            std::cerr << "Cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+            if(listener >= 0)
+                ::close(listener);
+            listener = -1;
+        }
+    }
+    ~Server() {
+        for(auto& c : connections)
+            drop(c);
+        if(listener >= 0)
+            ::close(listener);
+    }
+    Server(Server const&) = delete;
+    Server& operator=(Server const&) = delete;
+
+    bool listening() const { return listener >= 0; }
+    // Latency of every request served so far.
+    LatencyRecorder const& latency() const { return recorder; }
+
+    // Serve `socket`, already connected (one end of a socketpair, say), as if accepted.
+    void adopt(int socket) {
+        ::fcntl(socket, F_SETFL, ::fcntl(socket, F_GETFL) | O_NONBLOCK);
+        connections.emplace_back();
+        connections.back().fd = socket;
+    }
+
+    // Serve until `stop` becomes non-zero (e.g. set from a signal handler), or without a
+    // listening socket until the last connection closes.
+    void run(volatile std::sig_atomic_t const& stop) {
+        std::vector<pollfd> fds;
+        while(!stop && (listening() || !connections.empty())) {
+            fds.assign(1, {listener, POLLIN, 0});      // ignored by poll() if -1
+            for(auto& c : connections)
+                fds.push_back({c.fd, short(c.output.empty() ? POLLIN : POLLOUT), 0});
+            if(::poll(fds.data(), fds.size(), -1) < 0) {
+                if(errno == EINTR)
+                    continue;
+                break;
+            }
+            // handle clients first: accepting may grow `connections`
+            for(size_t i = connections.size(); i-- > 0; ) {
+                auto events = fds[i + 1].revents;
+                if(!events)
+                    continue;
+                if(!handle(connections[i], events)) {
+                    drop(connections[i]);
+                    connections.erase(connections.begin() + i);
+                }
+            }
+            if(fds[0].revents & POLLIN) {
+                int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+                if(fd >= 0)
+                    adopt(fd);
+            }
+        }
+    }
+};
+
+/****************************************************************************************
+ * Client side: owns the connection and the shared memfd.
+ */
+class Client {
+    int fd = -1;
+    char* region = nullptr;
+    uint64_t size = 0;
+
+public:
+    Client(char const* path, uint64_t bytes) : Client(connect_to(path), bytes) {}
+    // Take over `socket`, already connected to a server (e.g. the other end of a
+    // socketpair handed to Server::adopt()).
+    Client(int socket, uint64_t bytes) : fd(socket) {
+        if(fd < 0)
+            return;
+        int memfd = ::memfd_create("earclipper", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        void* mapped = MAP_FAILED;
+        if(memfd < 0 || ::ftruncate(memfd, bytes) < 0
+        || ::fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) < 0
+        || (mapped = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0)) == MAP_FAILED) {
+            if(memfd >= 0)
+                ::close(memfd);
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+
+        Hello hello;
+        hello.size = bytes;
+        iovec iov{&hello, sizeof(hello)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(memfd));
+        bool sent = ::sendmsg(fd, &msg, 0) == sizeof(hello);
+        ::close(memfd);     // the mapping keeps the memory alive
+        region = static_cast<char*>(mapped);
+        size = bytes;
+        if(!sent) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ~Client() {
+        if(region)
+            ::munmap(region, size);
+        if(fd >= 0)
+            ::close(fd);
+    }
+    Client(Client const&) = delete;
+    Client& operator=(Client const&) = delete;
+
+    bool connected() const { return fd >= 0; }
+    char* data() { return region; }
+    uint64_t bytes() const { return size; }
+
+    bool submit(Request const& req) { return write_all(fd, &req, sizeof(req)); }
+    bool receive(Reply& reply) { return read_all(fd, &reply, sizeof(reply)); }
+};
+
+} // namespace triangulation_service
+#endif
@@ -0,0 +1,280 @@
+#ifndef WINDING_TESSELLATION_H
+#define WINDING_TESSELLATION_H
+/****************************************************************************************
+ * Tessellation of self-overlapping input (unions of outlines, self-intersecting rings)
+ * under the even-odd or non-zero winding rule.
+ *
+ * The ring edges are made planar by sweeps over the grid points: a vertex of one edge
+ * on the interior of another splits it there, two neighbours crossing are split at
+ * their crossing rounded to the grid. Exact rational crossing events would need wider
+ * than 128 bit products, so a pass drops a crossed pair from the sweep instead and the
+ * next pass continues on the split edges until one finds nothing. Coincident pieces are
+ * merged with their windings summed.
+ *
+ * A last sweep gives every piece the winding number just above it; pieces with the
+ * filled side on one side only are the boundary. They are linked into rings (filled
+ * side on the left, so outlines come out counter clockwise and holes clockwise) and
+ * handed to triangulate_rings(). Filled areas meeting at a single vertex keep rings of
+ * their own.
+ **/
+
+#include "ring_set.h"
+#include "sweep_line.h"
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <vector>
+
+enum class WindingRule {
+    even_odd,
+    non_zero,
+};
+
+struct Tessellation {
+    std::vector<Ring> rings;                    // boundary of the filled region
+    std::vector<RingSetComponent> components;   // indices into the concatenated rings
+    bool complete = false;                      // crossings resolved, every component clipped
+};
+
+namespace winding {
+
+using Active = std::set<SweepEdge, SweepOrder>;
+
+// n / d rounded to the grid
+inline Num round_div(WideNum n, WideNum d) {
+    if constexpr(use_fixed_point_arithmetic) {
+        if(d < 0)
+            n = -n, d = -d;
+        return Num(n >= 0 ? (n + d / 2) / d : -((d / 2 - n) / d));
+    }
+    else
+        return Num(n / d);
+}
+
+// crossing point of two edges crossing properly, rounded to the grid
+inline Point crossing(SweepEdge const& s, SweepEdge const& t) {
+    WideNum den = WideNum(s.b.x - s.a.x) * (t.b.y - t.a.y) - WideNum(s.b.y - s.a.y) * (t.b.x - t.a.x);
+    WideNum num = WideNum(t.a.x - s.a.x) * (t.b.y - t.a.y) - WideNum(t.a.y - s.a.y) * (t.b.x - t.a.x);
+    return {s.a.x + round_div(num * (s.b.x - s.a.x), den), s.a.y + round_div(num * (s.b.y - s.a.y), den)};
+}
+
+inline bool crosses(SweepEdge const& s, SweepEdge const& t) {
+    return orientation(s.a, s.b, t.a) * orientation(s.a, s.b, t.b) < 0 &&
+           orientation(t.a, t.b, s.a) * orientation(t.a, t.b, s.b) < 0;
+}
+
+// One pass: the points at which each edge must be split. False if there are none.
+inline bool find_splits(std::vector<SweepEdge> const& edges, std::vector<std::vector<Point>>& splits) {
+    enum State : uint8_t { waiting, active, dropped };
+    Point event{0, 0};
+    Active status(SweepOrder{&event});
+    std::vector<Active::iterator> handles(edges.size());
+    std::vector<State> state(edges.size(), waiting);
+    std::vector<uint32_t> through;
+    bool found = false;
+
+    auto split = [&](uint32_t i, Point const& p) {
+        splits[i].push_back(p);
+        found = true;
+    };
+    // check neighbours lo, lo + 1 for a crossing; drop crossed pairs, check the new gap
+    auto check = [&](Active::iterator lo) {
+        while(lo != status.end() && std::next(lo) != status.end() && crosses(*lo, *std::next(lo))) {
+            auto hi = std::next(lo);
+            auto p = crossing(*lo, *hi);
+            split(lo->id, p);
+            split(hi->id, p);
+            state[lo->id] = state[hi->id] = dropped;
+            auto below = lo == status.begin() ? status.end() : std::prev(lo);
+            status.erase(lo);
+            status.erase(hi);
+            lo = below;
+        }
+    };
+    sweep_events(edges,
+        [&](uint32_t i) {
+            if(state[i] == active)
+                status.erase(handles[i]);
+            state[i] = dropped;
+        },
+        [&](Point const& p) {
+            // edges with p on their interior split there and go on past it
+            event = p;
+            auto [first, last] = status.equal_range(p);
+            through.clear();
+            for(auto it = first; it != last; ++it) {
+                through.push_back(it->id);
+                split(it->id, p);
+            }
+            status.erase(first, last);
+            for(auto i : through)
+                handles[i] = status.insert(edges[i]).first;
+        },
+        [&](uint32_t i) {
+            handles[i] = status.insert(edges[i]).first;
+            state[i] = active;
+        },
+        [&](Point const& p) {
+            // the new neighbours are the gaps below and above the edges through p
+            auto [first, last] = status.equal_range(p);
+            if(first != status.begin())
+                check(std::prev(first));
+            std::tie(first, last) = status.equal_range(p);
+            if(first != last)
+                check(std::prev(last));
+            return true;
+        });
+    return found;
+}
+
+// Cut edges at their split points and merge coincident pieces, summing windings;
+// pieces with winding 0 bound nothing and are left out.
+inline void split_and_merge(std::vector<SweepEdge>& edges, std::vector<int32_t>& windings,
+                            std::vector<std::vector<Point>> const& splits) {
+    std::vector<std::pair<SweepEdge, int32_t>> pieces;
+    std::vector<Point> cuts;
+    for(size_t i = 0; i < edges.size(); ++i) {
+        cuts.clear();
+        for(auto const& p : splits[i]) {
+            if(sweep_before(edges[i].a, p) && sweep_before(p, edges[i].b))
+                cuts.push_back(p);
+        }
+        cuts.push_back(edges[i].a);
+        cuts.push_back(edges[i].b);
+        std::sort(cuts.begin(), cuts.end(), sweep_before);
+        cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+        for(size_t k = 0; k + 1 < cuts.size(); ++k)
+            pieces.push_back({SweepEdge{cuts[k], cuts[k + 1]}, windings[i]});
+    }
+    std::sort(pieces.begin(), pieces.end(), [](auto const& u, auto const& v) {
+        return u.first.a != v.first.a ? sweep_before(u.first.a, v.first.a) : sweep_before(u.first.b, v.first.b);
+    });
+    edges.clear();
+    windings.clear();
+    for(size_t k = 0; k < pieces.size(); ) {
+        auto piece = pieces[k].first;
+        int32_t winding = 0;
+        for(; k < pieces.size() && pieces[k].first.a == piece.a && pieces[k].first.b == piece.b; ++k)
+            winding += pieces[k].second;
+        if(winding) {
+            piece.id = edges.size();
+            edges.push_back(piece);
+            windings.push_back(winding);
+        }
+    }
+}
+
+// Rank of direction d by the clockwise turn from r: (0, pi), [pi, 2pi), then 0.
+inline int turn_rank(Point const& r, Point const& d) {
+    auto c = sign(WideNum(r.x) * d.y - WideNum(r.y) * d.x);
+    auto dot = sign(WideNum(r.x) * d.x + WideNum(r.y) * d.y);
+    return c < 0 ? 0 : c > 0 || dot < 0 ? 1 : 2;
+}
+
+} // namespace winding
+
+// Boundary rings of the region filled under `rule`, outlines counter clockwise and
+// holes clockwise. None, and `resolved` false, if the edges are not planar after
+// `max_passes`.
+inline std::vector<Ring> winding_boundary(std::vector<Ring> const& rings, WindingRule rule,
+                                          bool* resolved = nullptr, size_t max_passes = 64) {
+    std::vector<SweepEdge> edges;
+    std::vector<int32_t> windings;
+    for(auto const& ring : rings) {
+        auto n = ring_set::open_size(ring);
+        for(size_t i = 0; i < n && n >= 3; ++i) {
+            auto e = SweepEdge::make(ring[i], ring[(i + 1) % n], edges.size());
+            if(e.a == e.b)
+                continue;
+            edges.push_back(e);
+            windings.push_back(e.reversed ? -1 : 1);   // +1 crossing it from right to left
+        }
+    }
+    std::vector<std::vector<Point>> splits(edges.size());
+    winding::split_and_merge(edges, windings, splits);
+    bool planar = false;
+    for(size_t pass = 0; pass < max_passes && !planar; ++pass) {
+        splits.assign(edges.size(), {});
+        planar = !winding::find_splits(edges, splits);
+        if(!planar)
+            winding::split_and_merge(edges, windings, splits);
+    }
+    if(resolved)
+        *resolved = planar;
+    if(!planar)
+        return {};
+
+    // winding number above each piece, from the piece below it
+    Point event{0, 0};
+    winding::Active status(SweepOrder{&event});
+    std::vector<winding::Active::iterator> handles(edges.size());
+    std::vector<int32_t> above(edges.size());
+    sweep_events(edges,
+        [&](uint32_t i) { status.erase(handles[i]); },
+        [&](Point const& p) { event = p; },
+        [&](uint32_t i) { handles[i] = status.insert(edges[i]).first; },
+        [&](Point const& p) {
+            auto [first, last] = status.equal_range(p);
+            int32_t below = first == status.begin() ? 0 : above[std::prev(first)->id];
+            for(auto it = first; it != last; ++it)
+                below = above[it->id] = below + windings[it->id];
+            return true;
+        });
+
+    // boundary pieces, directed with the filled side on the left (above)
+    auto filled = [rule](int32_t w) { return rule == WindingRule::even_odd ? (w & 1) != 0 : w != 0; };
+    std::vector<std::pair<Point, Point>> boundary;
+    for(size_t i = 0; i < edges.size(); ++i) {
+        bool up = filled(above[i]), down = filled(above[i] - windings[i]);
+        if(up != down)
+            boundary.push_back(up ? std::make_pair(edges[i].a, edges[i].b) : std::make_pair(edges[i].b, edges[i].a));
+    }
+    auto by_from = [](auto const& u, auto const& v) { return sweep_before(u.first, v.first); };
+    std::sort(boundary.begin(), boundary.end(), by_from);
+
+    // link the pieces: arriving at a vertex, leave by the first outgoing piece clockwise
+    // from the way back, which walks around one face and keeps faces that only meet at
+    // a vertex apart
+    std::vector<uint32_t> next(boundary.size());
+    for(uint32_t k = 0; k < boundary.size(); ++k) {
+        auto [from, to] = boundary[k];
+        auto [first, last] = std::equal_range(boundary.begin(), boundary.end(), std::make_pair(to, to), by_from);
+        Point back{from.x - to.x, from.y - to.y};
+        auto best = first;
+        for(auto it = std::next(first); it != last; ++it) {
+            Point d{it->second.x - to.x, it->second.y - to.y}, b{best->second.x - to.x, best->second.y - to.y};
+            auto rd = winding::turn_rank(back, d), rb = winding::turn_rank(back, b);
+            if(rd < rb || (rd == rb && orientation({0, 0}, b, d) > 0))
+                best = it;
+        }
+        next[k] = best - boundary.begin();
+    }
+
+    std::vector<Ring> result;
+    std::vector<bool> used(boundary.size());
+    for(uint32_t start = 0; start < boundary.size(); ++start) {
+        if(used[start])
+            continue;
+        Ring ring;
+        for(auto k = start; !used[k]; k = next[k]) {
+            used[k] = true;
+            ring.push_back(boundary[k].first);
+        }
+        result.push_back(std::move(ring));
+    }
+    return result;
+}
+
+// Triangulate the region filled under `rule`: its boundary rings and their triangles.
+inline Tessellation tessellate(std::vector<Ring> const& rings, WindingRule rule,
+                               ThreadPool& pool = ThreadPool::instance()) {
+    Tessellation result;
+    bool resolved = false;
+    result.rings = winding_boundary(rings, rule, &resolved);
+    result.components = triangulate_rings(result.rings, pool);
+    result.complete = resolved;
+    for(auto const& component : result.components)
+        result.complete &= component.complete;
+    return result;
+}
+#endif